@@ -0,0 +1,144 @@
+/*
+ * @file    dwt.h
+ * @brief   基于DWT周期计数器的精确延时
+ * @details 延时以纳秒为单位，与编译优化等级无关，只依赖内核时钟。
+ *          热路径上的延时函数为内联函数，调用前必须先执行 DWT_Init()。
+ *
+ *          32位周期计数器在480MHz下约8.9秒回绕一次，DWT_Cycles64() 在软件中记录回绕次数，
+ *          得到不回绕的64位时基；SysTick中断每毫秒调用一次，保证不会漏掉回绕。
+ *          在此之上提供微秒时间戳和截止时间，超时可以按微秒甚至纳秒设置，而不是HAL_GetTick的毫秒。
+ */
+#ifndef DWT_H__
+#define DWT_H__
+
+#include "main.h"
+
+/**
+ * @brief 每纳秒的内核周期数 (Q16定点)，由 DWT_Init() 根据 SystemCoreClock 计算
+ */
+extern uint32_t g_dwt_cycles_per_ns_q16;
+
+/**
+ * @brief 一次 DWT_Delay_ns() 调用本身消耗的周期数，由 DWT_Init() 校准
+ */
+extern uint32_t g_dwt_overhead_cycles;
+
+/**
+ * @brief 每微秒的内核周期数，由 DWT_Init() 根据 SystemCoreClock 计算
+ */
+extern uint32_t g_dwt_cycles_per_us;
+
+/**
+ * @brief 截止时间
+ */
+typedef struct {
+    uint64_t end;   // 到期时刻，64位周期计数
+} DWT_DeadlineTypeDef;
+
+/**
+ * @brief 初始化DWT周期计数器并校准延时参数
+ * @note  必须在 SystemClock_Config() 之后调用，修改内核时钟后需要重新调用
+ */
+void DWT_Init(void);
+
+/**
+ * @brief 读取64位周期计数
+ * @note  中断和主循环中都可以调用；两次调用的间隔不能超过一个回绕周期，由SysTick中断保证
+ */
+uint64_t DWT_Cycles64(void);
+
+/**
+ * @brief 读取当前周期计数
+ */
+static inline uint32_t DWT_Cycles(void)
+{
+    return DWT->CYCCNT;
+}
+
+/**
+ * @brief 纳秒换算为内核周期数 (向上取整)
+ */
+static inline uint32_t DWT_ns_to_cycles(uint32_t ns)
+{
+    return (uint32_t)(((uint64_t)ns * g_dwt_cycles_per_ns_q16 + 0xFFFF) >> 16);
+}
+
+/**
+ * @brief 内核周期数换算为纳秒
+ */
+static inline uint32_t DWT_cycles_to_ns(uint32_t cycles)
+{
+    return (uint32_t)(((uint64_t)cycles << 16) / g_dwt_cycles_per_ns_q16);
+}
+
+/**
+ * @brief 忙等待指定的周期数
+ * @param cycles 等待的周期数
+ * @note  使用无符号减法，计数器回绕不影响结果
+ */
+static inline void DWT_Delay_Cycles(uint32_t cycles)
+{
+    uint32_t start = DWT->CYCCNT;
+
+    while ((DWT->CYCCNT - start) < cycles) {
+    }
+}
+
+/**
+ * @brief 忙等待指定的纳秒数，保证实际延时不少于 ns
+ * @param ns 延时时间，单位纳秒
+ */
+static inline void DWT_Delay_ns(uint32_t ns)
+{
+    uint32_t start = DWT->CYCCNT;
+    uint32_t cycles = DWT_ns_to_cycles(ns);
+
+    cycles = (cycles > g_dwt_overhead_cycles) ? cycles - g_dwt_overhead_cycles : 0;
+    while ((DWT->CYCCNT - start) < cycles) {
+    }
+}
+
+/**
+ * @brief 忙等待指定的微秒数
+ * @param us 延时时间，单位微秒
+ */
+static inline void DWT_Delay_us(uint32_t us)
+{
+    DWT_Delay_ns(us * 1000);
+}
+
+/**
+ * @brief 微秒时间戳，约71分钟回绕一次
+ * @note  比较两个时间戳时使用无符号减法
+ */
+static inline uint32_t DWT_Micros(void)
+{
+    return (uint32_t)(DWT_Cycles64() / g_dwt_cycles_per_us);
+}
+
+/**
+ * @brief 设置从现在起 us 微秒后到期的截止时间
+ */
+static inline void DWT_Deadline_us(DWT_DeadlineTypeDef *d, uint32_t us)
+{
+    d->end = DWT_Cycles64() + (uint64_t)us * g_dwt_cycles_per_us;
+}
+
+/**
+ * @brief 设置从现在起 ns 纳秒后到期的截止时间
+ */
+static inline void DWT_Deadline_ns(DWT_DeadlineTypeDef *d, uint32_t ns)
+{
+    d->end = DWT_Cycles64() + DWT_ns_to_cycles(ns);
+}
+
+/**
+ * @brief 截止时间是否已到
+ * @return 1表示已到期
+ */
+static inline uint8_t DWT_Expired(const DWT_DeadlineTypeDef *d)
+{
+    return DWT_Cycles64() >= d->end;
+}
+
+#endif // DWT_H__
@@ -2,11 +2,229 @@
 #define TDC_H__
 
 #include "main.h"
+#include "tdc_config.h"
+#include "tdc_reg.h"
+#include "tdc_io.h"
 
-void TDC_Init();
+/**
+ * @brief 测量范围
+ */
+typedef enum {
+    TDC_RANGE_1 = 1, // 3.5ns - 1.8us，支持多脉冲
+    TDC_RANGE_2 = 2, // 500ns - 4ms，STOP1单脉冲
+} TDC_RangeTypeDef;
 
-uint8_t TDC_Measure(uint32_t *result, uint32_t timeout);
+/**
+ * @brief 状态寄存器 (0xB4)
+ */
+typedef union {
+    struct {
+        uint16_t ptr : 3;            // 结果寄存器指针，即已算出的结果个数
+        uint16_t hits1 : 3;          // STOP1收到的脉冲数
+        uint16_t hits2 : 3;          // STOP2收到的脉冲数
+        uint16_t timeout_tdc : 1;    // TDC溢出，STOP缺失
+        uint16_t timeout_precnt : 1; // 预分频器溢出 (测量范围2)
+        uint16_t err_open : 1;       // 温度测量传感器开路
+        uint16_t err_short : 1;      // 温度测量传感器短路
+        uint16_t eep_eq : 1;         // EEPROM与配置寄存器相同
+        uint16_t eep_ded : 1;        // EEPROM双错误
+        uint16_t eep_err : 1;        // EEPROM单错误
+    } bit;
+    uint16_t raw;
+} TDC_StatusTypeDef;
 
-float TDC_to_ns(uint32_t val);
+/**
+ * @brief 状态寄存器中表示本次测量不完整的标志
+ */
+#define TDC_STATUS_TIMEOUT_MSK 0x0600U
 
-#endif // TDC_H__
\ No newline at end of file
+/**
+ * @brief 恢复方式，按代价从小到大排列
+ */
+typedef enum {
+    TDC_RECOVER_NONE   = 0, // 不需要恢复
+    TDC_RECOVER_INIT   = 1, // 只发送Init (0x70)
+    TDC_RECOVER_REINIT = 2, // 复位并重新写入全部配置
+} TDC_RecoverTypeDef;
+
+/**
+ * @brief 错误与恢复计数
+ */
+typedef struct {
+    uint32_t timeout_tdc;     // TDC溢出 (STOP缺失) 的测量次数
+    uint32_t timeout_precnt;  // 预分频器溢出的测量次数
+    uint32_t no_int;          // 没有产生TDC_INT的测量次数
+    uint32_t init;            // 用Init恢复的次数
+    uint32_t reinit;          // 复位并重新配置的次数
+    uint32_t eep_fallback;    // EEPROM中的配置不一致，改为逐字写入的次数
+    uint32_t io_timeout;      // 总线事务超时或出错的次数 (硬件SPI、DMA模拟SPI后端)
+} TDC_ErrorStatsTypeDef;
+
+/**
+ * @brief 一次START的全部测量结果
+ * @note  结果按 STOP1第1..N个脉冲、STOP2第1..M个脉冲 的顺序排列，都是相对START的时间
+ */
+typedef struct {
+    TDC_StatusTypeDef status;     // 读出结束时的状态寄存器
+    uint8_t count;                // 有效结果个数
+    uint32_t raw[TDC_MAX_HITS];   // 原始测量结果 (RES_0 - RES_3)
+} TDC_HitsTypeDef;
+
+/**
+ * @brief 流水线测量的吞吐量
+ */
+typedef struct {
+    uint32_t shots;       // 流水线中完成的测量次数
+    uint32_t rate_hz;     // 平均测量速率
+    uint32_t period_ns;   // 相邻两次完成之间的平均时间
+    uint32_t latch_ns;    // 从TDC_INT到下一个START的平均时间，即不能与转换重叠的部分
+} TDC_PipeStatsTypeDef;
+
+/**
+ * @brief START脉冲发出后的回调
+ */
+typedef void (*TDC_StartCallbackTypeDef)(TDC_HandleTypeDef *htdc);
+
+/**
+ * @brief 晶振校准完成回调，在TDC_INT的EXTI中断中调用
+ */
+typedef void (*TDC_CalCallbackTypeDef)(TDC_HandleTypeDef *htdc);
+
+/**
+ * @brief 测量完成回调，在TDC_INT的EXTI中断中调用
+ * @param htdc 完成测量的TDC
+ * @param hits 本次START的全部测量结果，只在回调期间有效
+ */
+typedef void (*TDC_CpltCallbackTypeDef)(TDC_HandleTypeDef *htdc, const TDC_HitsTypeDef *hits);
+
+/**
+ * @brief TDC句柄，每片GP22一个
+ * @note  多片GP22共用SCK/SI/SO和START脉冲，SSN、TDC_INT、RTN各自独立
+ */
+struct __TDC_HandleTypeDef {
+    // 引脚与总线
+    SPI_HandleTypeDef *hspi;             // 硬件SPI句柄，不使用硬件SPI时为NULL
+    const TDC_IO_OpsTypeDef *ops;        // 当前使用的总线后端
+    GPIO_TypeDef *ssn_port;              // SSN片选
+    uint16_t ssn_pin;
+    GPIO_TypeDef *int_port;              // TDC_INT中断输出
+    uint16_t int_pin;
+    GPIO_TypeDef *rtn_port;              // RTN复位
+    uint16_t rtn_pin;
+
+    // 配置与影子寄存器，shadow 是芯片中寄存器0-5的当前内容
+    TDC_ConfigTypeDef cfg;
+    uint32_t shadow[TDC_CFG_WORDS];
+    uint8_t hitin1;                      // 测量范围1的STOP1脉冲数
+    uint8_t hitin2;                      // 测量范围1的STOP2脉冲数
+
+    // 晶振校准缓存
+    volatile uint32_t tref_fs;           // 当前使用的Tref (fs)
+    volatile uint8_t cal_valid;          // 缓存有效
+    volatile uint32_t cal_tick;          // 上次校准的HAL_GetTick
+    uint32_t cal_interval;               // 刷新周期 (ms)，0表示不自动刷新
+
+    // 异步测量状态，由EXTI中断和主循环共享
+    volatile uint8_t busy;               // 测量进行中
+    volatile uint8_t done;               // 最近一次测量已完成
+    volatile uint8_t cal_run;            // 进行中的是晶振校准而不是测量
+    volatile uint32_t result;            // 最近一次测量结果
+    TDC_HitsTypeDef hits;                // 最近一次测量的全部结果
+    TDC_StartCallbackTypeDef start_cb;   // START脉冲发出后的回调
+    TDC_CpltCallbackTypeDef cplt_cb;     // 测量完成回调 (中断上下文)
+    TDC_CalCallbackTypeDef cal_cb;       // 晶振校准完成回调 (中断上下文)
+    TDC_ErrorStatsTypeDef err;           // 错误与恢复计数
+
+    // 流水线测量
+    volatile uint8_t pipe_run;           // 流水线进行中
+    uint32_t pipe_left;                  // 剩余次数，0表示不限
+    volatile uint32_t pipe_shots;        // 已完成次数
+    uint32_t pipe_t_int;                 // 上一次TDC_INT的DWT周期数
+    volatile uint32_t pipe_t_fire;       // 最近一次START或插入校准开始的DWT周期数，用于判断停住
+    uint64_t pipe_period_sum;            // 相邻两次TDC_INT间隔之和 (周期)
+    uint64_t pipe_latch_sum;             // TDC_INT到下一个START的时间之和 (周期)
+};
+
+void TDC_Init_Instance(TDC_HandleTypeDef *htdc, SPI_HandleTypeDef *hspi,
+                       GPIO_TypeDef *ssn_port, uint16_t ssn_pin);
+
+void TDC_Config_Pins(TDC_HandleTypeDef *htdc, GPIO_TypeDef *int_port, uint16_t int_pin,
+                     GPIO_TypeDef *rtn_port, uint16_t rtn_pin);
+
+void TDC_Init(TDC_HandleTypeDef *htdc);
+
+HAL_StatusTypeDef TDC_Set_Hits(TDC_HandleTypeDef *htdc, uint8_t stop1, uint8_t stop2);
+
+uint8_t TDC_Hits_Stop1_Count(const TDC_HandleTypeDef *htdc, const TDC_HitsTypeDef *hits);
+
+HAL_StatusTypeDef TDC_Config_Apply(TDC_HandleTypeDef *htdc, const TDC_ConfigTypeDef *cfg);
+
+void TDC_Config_Get(TDC_HandleTypeDef *htdc, TDC_ConfigTypeDef *cfg);
+
+HAL_StatusTypeDef TDC_EEPROM_Store(TDC_HandleTypeDef *htdc);
+
+HAL_StatusTypeDef TDC_EEPROM_Load(TDC_HandleTypeDef *htdc, const TDC_ConfigTypeDef *cfg);
+
+HAL_StatusTypeDef TDC_Set_Range(TDC_HandleTypeDef *htdc, TDC_RangeTypeDef range);
+
+TDC_RangeTypeDef TDC_Get_Range(TDC_HandleTypeDef *htdc);
+
+HAL_StatusTypeDef TDC_Cal_Start_IT(TDC_HandleTypeDef *htdc);
+
+HAL_StatusTypeDef TDC_Calibrate(TDC_HandleTypeDef *htdc, uint32_t timeout_us);
+
+uint8_t TDC_Cal_Due(TDC_HandleTypeDef *htdc);
+
+void TDC_Cal_Invalidate(TDC_HandleTypeDef *htdc);
+
+void TDC_Cal_Set_Interval(TDC_HandleTypeDef *htdc, uint32_t interval_ms);
+
+void TDC_Register_Cal_Callback(TDC_HandleTypeDef *htdc, TDC_CalCallbackTypeDef cal_cb);
+
+uint32_t TDC_Get_Tref_fs(TDC_HandleTypeDef *htdc);
+
+void TDC_Register_Callbacks(TDC_HandleTypeDef *htdc, TDC_StartCallbackTypeDef start_cb, TDC_CpltCallbackTypeDef cplt_cb);
+
+HAL_StatusTypeDef TDC_Measure_Arm_IT(TDC_HandleTypeDef *htdc);
+
+HAL_StatusTypeDef TDC_Measure_Start_IT(TDC_HandleTypeDef *htdc);
+
+HAL_StatusTypeDef TDC_Measure_Start_Multi_IT(TDC_HandleTypeDef *const htdc[], uint8_t n);
+
+void TDC_Measure_Abort(TDC_HandleTypeDef *htdc);
+
+HAL_StatusTypeDef TDC_Pipeline_Start_IT(TDC_HandleTypeDef *htdc, uint32_t count);
+
+void TDC_Pipeline_Stop(TDC_HandleTypeDef *htdc);
+
+uint8_t TDC_Pipeline_Poll(TDC_HandleTypeDef *htdc);
+
+uint8_t TDC_Pipeline_Is_Running(TDC_HandleTypeDef *htdc);
+
+void TDC_Pipeline_Get_Stats(TDC_HandleTypeDef *htdc, TDC_PipeStatsTypeDef *stats);
+
+uint8_t TDC_Is_Busy(TDC_HandleTypeDef *htdc);
+
+uint8_t TDC_Get_Result(TDC_HandleTypeDef *htdc, uint32_t *result);
+
+uint8_t TDC_Get_Hits(TDC_HandleTypeDef *htdc, TDC_HitsTypeDef *hits);
+
+void TDC_INT_IRQHandler(TDC_HandleTypeDef *htdc);
+
+void TDC_EXTI_IRQHandler(void);
+
+uint8_t TDC_Measure(TDC_HandleTypeDef *htdc, uint32_t *result, uint32_t timeout_us);
+
+uint8_t TDC_Measure_Hits(TDC_HandleTypeDef *htdc, TDC_HitsTypeDef *hits, uint32_t timeout_us);
+
+uint32_t TDC_Get_Status_Reg(TDC_HandleTypeDef *htdc);
+
+TDC_StatusTypeDef TDC_Get_Status(TDC_HandleTypeDef *htdc);
+
+TDC_RecoverTypeDef TDC_Recover(TDC_HandleTypeDef *htdc);
+
+void TDC_Get_Error_Stats(TDC_HandleTypeDef *htdc, TDC_ErrorStatsTypeDef *stats);
+
+float TDC_to_ns(TDC_HandleTypeDef *htdc, uint32_t val);
+
+#endif // TDC_H__
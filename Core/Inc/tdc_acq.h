@@ -0,0 +1,134 @@
+/*
+ * @file    tdc_acq.h
+ * @brief   TIM4定时触发的TDC连续采集
+ * @details TIM4更新事件 (TRGO) 直接触发TIM1单脉冲发出START，TDC_INT完成中断读出结果、
+ *          带时间戳写入无锁环形缓冲区，并为下一个边沿发送Init。
+ *          显示、统计、串口等消费者在主循环中按自己的节奏读取。
+ */
+#ifndef TDC_ACQ_H__
+#define TDC_ACQ_H__
+
+#include "main.h"
+#include "tdc_ring.h"
+#include "tdc_stats.h"
+#include "tdc_dist.h"
+#include "tdc_ref.h"
+
+/**
+ * @brief 连续采集计数
+ */
+typedef struct {
+    uint32_t triggers;   // TIM4触发次数
+    uint32_t missed;     // 触发时上一次测量尚未完成而跳过的次数
+    uint32_t completed;  // 完成的测量次数
+    uint32_t overrun;    // 环形缓冲区满而丢弃的记录数
+    uint32_t recovered;  // TDC_INT丢失后恢复的次数
+} TDC_AcqStatsTypeDef;
+
+/**
+ * @brief 设置重复频率
+ * @param rate_hz START脉冲频率，单位Hz
+ * @return HAL_OK 设置成功；HAL_ERROR 频率超出TIM4可以产生的范围
+ * @note  采集进行中也可以调用，从下一个周期开始生效
+ */
+HAL_StatusTypeDef TDC_Acq_Set_Rate(uint32_t rate_hz);
+
+/**
+ * @brief 开始连续采集
+ * @param htdc 进行采集的TDC
+ * @param rate_hz START脉冲频率，单位Hz
+ * @return HAL_OK 已启动；HAL_ERROR 频率无效或定时器启动失败；HAL_BUSY DMA读出 (tdc_dma.h) 正在使用TIM4
+ * @note  采集期间不要再调用 TDC_Measure() 等单次测量函数
+ */
+HAL_StatusTypeDef TDC_Acq_Start(TDC_HandleTypeDef *htdc, uint32_t rate_hz);
+
+/**
+ * @brief 开启STOP2参考通道的漂移补偿
+ * @param htdc 进行采集的TDC，设置为STOP1、STOP2各接收1个脉冲
+ * @param ref_ps 参考延迟的已知值 (ps)，TDC_REF_AUTO表示以第一次测得的值为基准
+ * @param shift 漂移的平滑系数 1/2^shift，0表示逐次扣除
+ * @return HAL_OK 已开启；HAL_BUSY 采集进行中；HAL_ERROR 当前测量范围不支持STOP2
+ * @note  在 TDC_Acq_Start() 之前调用。开启后记录中的ps、时间统计和分布统计都是补偿后的值
+ */
+HAL_StatusTypeDef TDC_Acq_Set_Reference(TDC_HandleTypeDef *htdc, int64_t ref_ps, uint8_t shift);
+
+/**
+ * @brief 关闭参考通道补偿，STOP1、STOP2的脉冲数不恢复
+ */
+void TDC_Acq_Clear_Reference(void);
+
+/**
+ * @brief 获取参考通道补偿状态
+ * @return 1表示已开启
+ */
+uint8_t TDC_Acq_Get_Reference(TDC_RefTypeDef *ref);
+
+/**
+ * @brief 开启双通道测量：STOP1、STOP2各接一路被测信号，共用同一个START
+ * @param htdc 进行采集的TDC，设置为STOP1、STOP2各接收1个脉冲
+ * @return HAL_OK 已开启；HAL_BUSY 采集进行中；HAL_ERROR 当前测量范围不支持STOP2
+ * @note  在 TDC_Acq_Start() 之前调用。两个通道的结果在同一次读出中取回，
+ *        分别写入带通道号的记录并计入各自的统计，每个START得到两个测量值。
+ *        与参考通道补偿都使用STOP2，开启一个会关闭另一个
+ */
+HAL_StatusTypeDef TDC_Acq_Set_Dual(TDC_HandleTypeDef *htdc);
+
+/**
+ * @brief 关闭双通道测量，STOP1、STOP2的脉冲数不恢复
+ */
+void TDC_Acq_Clear_Dual(void);
+
+/**
+ * @brief 停止连续采集，已在缓冲区中的记录仍然可以读取
+ */
+void TDC_Acq_Stop(void);
+
+/**
+ * @brief 查询连续采集是否进行中
+ * @return 1表示进行中
+ */
+uint8_t TDC_Acq_Is_Running(void);
+
+/**
+ * @brief 从环形缓冲区取出一条记录
+ * @return 1表示取到记录，0表示没有新记录
+ */
+uint8_t TDC_Acq_Read(TDC_RecordTypeDef *rec);
+
+/**
+ * @brief 获取采集计数
+ */
+void TDC_Acq_Get_Stats(TDC_AcqStatsTypeDef *stats);
+
+/**
+ * @brief 获取第一个STOP时间 (STOP1通道) 的统计快照 (ps)
+ * @note  统计在完成中断里随采集更新，窗口长度为 TDC_STATS_WINDOW
+ */
+void TDC_Acq_Get_Time_Stats(TDC_StatsSnapshotTypeDef *snap);
+
+/**
+ * @brief 获取第一个STOP时间的分位数和直方图快照
+ * @note  直方图箱宽为 TDC_HIST_BIN_PS，以采集开始后的第一个样本为中心
+ */
+void TDC_Acq_Get_Dist(TDC_DistSnapshotTypeDef *snap);
+
+/**
+ * @brief 获取某个通道的时间统计快照 (ps)
+ * @param ch 通道，TDC_CH_STOP1 与 TDC_Acq_Get_Time_Stats() 相同
+ * @return HAL_OK 成功；HAL_ERROR 通道无效
+ */
+HAL_StatusTypeDef TDC_Acq_Get_Channel_Stats(uint8_t ch, TDC_StatsSnapshotTypeDef *snap);
+
+/**
+ * @brief 获取某个通道的分位数和直方图快照
+ * @param ch 通道，TDC_CH_STOP1 与 TDC_Acq_Get_Dist() 相同
+ * @return HAL_OK 成功；HAL_ERROR 通道无效
+ */
+HAL_StatusTypeDef TDC_Acq_Get_Channel_Dist(uint8_t ch, TDC_DistSnapshotTypeDef *snap);
+
+/**
+ * @brief 清零所有通道的时间统计和分布统计，采集不停止
+ */
+void TDC_Acq_Reset_Time_Stats(void);
+
+#endif // TDC_ACQ_H__
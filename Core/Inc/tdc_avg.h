@@ -0,0 +1,116 @@
+/*
+ * @file    tdc_avg.h
+ * @brief   START相位抖动的多次测量平均
+ * @details 连续进行N次 TDC_Measure()，每次把PULSE引脚 (TIM1_CH3) 的START上升沿推迟不同的TIM1时钟数。
+ *          STOP由START产生 (如电缆反射，本装置的情况) 时两者一起推迟，间隔和量化位置都不变，
+ *          抖动只改变与MCU时钟的相对相位，平均只能减小随机噪声，不能消除量化误差，默认不抖动。
+ *          STOP由与TIM1同一时钟的定时器产生时，被测间隔每档缩短一个TIM1时钟 (约4.2ns，
+ *          不是GP22量化步长的整数倍)，各次测量落在延迟线量化台阶的不同位置上，量化误差在平均中抵消，
+ *          推迟量再从结果中加回 (compensate = 1)。加回量按TIM1时钟计算，HSI约±1%的偏差
+ *          每档带来约40ps的误差，因此要求先用 TDC_Pulse_Set_Clock_Error() 设置经GP22 Tref校准的偏差。
+ *          STOP与MCU时钟无关时推迟量没有确定的关系，不能补偿。
+ *          平均、方差都用整数计算，结果给出平均值的标准误差和相对GP22量化步长的分辨率提高倍数。
+ *          给定置信区间目标时每次测量后更新95%置信区间，达到目标立即停止，
+ *          稳定的电缆少测，噪声大的电缆多测。
+ */
+#ifndef TDC_AVG_H__
+#define TDC_AVG_H__
+
+#include "main.h"
+#include "tdc.h"
+#include "tdc_stats.h"
+
+/**
+ * @brief START相位抖动方式
+ */
+typedef enum {
+    TDC_DITHER_NONE = 0, // 不抖动
+    TDC_DITHER_RAMP = 1, // 0, 1, ..., steps-1 个时钟循环
+    TDC_DITHER_PRBS = 2, // 伪随机序列取 0 ~ steps-1
+} TDC_DitherTypeDef;
+
+/**
+ * @brief 平均测量参数
+ */
+typedef struct {
+    uint32_t n;               // 有效测量次数；给定ci_q4时为上限，0表示只受总时间限制
+    uint32_t ci_q4;           // 95%置信区间半宽目标，单位ps，Q4定点，0表示固定次数
+    uint32_t min_n;           // 给定ci_q4时开始判断前至少需要的样本数
+    TDC_DitherTypeDef dither; // 相位抖动方式
+    uint8_t steps;            // 相位档数，每档一个TIM1时钟
+    uint8_t compensate;       // 1: STOP由锁定TIM1时钟的定时器产生，把START推迟的时间加回结果，
+                              //    抖动使量化误差去相关，要求TIM1时钟已校准；
+                              // 0: STOP由START产生 (电缆反射)，间隔不受推迟影响，抖动不改善量化
+    uint32_t shot_timeout;    // 单次测量超时，单位微秒
+    uint32_t max_fail;        // 失败次数达到这个值时放弃，0表示不限
+    uint32_t max_spread_ps;   // 最大值与最小值之差超过这个值时放弃 (信号不稳定)，0表示不限
+    uint32_t timeout;         // 总时间，单位微秒，0表示不限 (此时n不能为0)
+} TDC_AvgConfigTypeDef;
+
+/**
+ * @brief 默认参数
+ * @note  默认STOP由START产生 (电缆反射)，不抖动也不补偿。STOP锁定TIM1时钟时可以改为
+ *        dither = TDC_DITHER_RAMP、compensate = 1，并先校准TIM1时钟
+ */
+#define TDC_AVG_CONFIG_DEFAULT {               \
+    .n = TDC_AVG_DEFAULT_N,                    \
+    .ci_q4 = 0,                                \
+    .min_n = TDC_AVG_MIN_N,                    \
+    .dither = TDC_DITHER_NONE,                 \
+    .steps = TDC_AVG_DITHER_STEPS,             \
+    .compensate = 0,                           \
+    .shot_timeout = 100,                       \
+    .max_fail = 8,                             \
+    .max_spread_ps = 0,                        \
+    .timeout = 1000000,                        \
+}
+
+/**
+ * @brief 平均测量结束原因
+ */
+typedef enum {
+    TDC_AVG_OK           = 0, // 完成全部次数或达到置信区间目标
+    TDC_AVG_ABORT_FAIL   = 1, // 失败次数过多
+    TDC_AVG_ABORT_SPREAD = 2, // 结果分散超过限制
+    TDC_AVG_ABORT_TIME   = 3, // 超过总时间
+    TDC_AVG_ABORT_COUNT  = 4, // 达到次数上限仍未达到置信区间目标
+    TDC_AVG_ABORT_DELAY  = 5, // 无法设置START推迟量 (脉冲正在输出或超出TIM1范围)
+} TDC_AvgStatusTypeDef;
+
+/**
+ * @brief 平均测量结果
+ */
+typedef struct {
+    TDC_AvgStatusTypeDef status;
+    uint32_t failed;              // 没有结果的测量次数
+    TDC_StatsResultTypeDef stats; // 有效结果的统计 (ps)，平均值为 stats.mean_q4
+    uint32_t lsb_q4;              // GP22的量化步长 TDC_GP22_LSB_PS，单位ps，Q4定点
+    uint32_t res_q4;              // 有效分辨率，即平均值的标准误差，单位ps，Q4定点
+    uint32_t gain_q8;             // 相对单次量化步长的分辨率提高倍数 lsb/res，Q8定点
+    uint32_t ci_q4;               // 实际达到的95%置信区间半宽，单位ps，Q4定点
+} TDC_AvgResultTypeDef;
+
+/**
+ * @brief 进行一次抖动平均测量 (阻塞方式)
+ * @param htdc TDC句柄
+ * @param cfg 测量参数
+ * @param res 测量结果，放弃时是已完成部分的统计
+ * @return HAL_OK 完成全部次数或达到置信区间目标；HAL_TIMEOUT 超过总时间；
+ *         HAL_ERROR 参数错误 (包括compensate = 1而TIM1时钟未校准)，
+ *         或因失败、分散、次数上限、START推迟量无法设置放弃
+ * @note  START由软件触发，不能与TIM4连续采集同时使用。结束后START恢复原来的相位。
+ */
+HAL_StatusTypeDef TDC_Measure_Avg(TDC_HandleTypeDef *htdc, const TDC_AvgConfigTypeDef *cfg, TDC_AvgResultTypeDef *res);
+
+/**
+ * @brief 测到给定精度为止 (阻塞方式)
+ * @param htdc TDC句柄
+ * @param ci_q4 95%置信区间半宽目标，单位ps，Q4定点，例如 ±2ps 为 32
+ * @param timeout_us 总时间，单位微秒，不能为0
+ * @param res 测量结果：估计值 stats.mean_q4、实际区间 ci_q4、样本数 stats.n
+ * @return 同 TDC_Measure_Avg()；ci_q4或timeout_us为0时返回HAL_ERROR
+ * @note  其余参数取 TDC_AVG_CONFIG_DEFAULT
+ */
+HAL_StatusTypeDef TDC_Measure_Target(TDC_HandleTypeDef *htdc, uint32_t ci_q4, uint32_t timeout_us, TDC_AvgResultTypeDef *res);
+
+#endif // TDC_AVG_H__
@@ -0,0 +1,36 @@
+/*
+ * @file    tdc_bbdma.h
+ * @brief   定时器节拍的DMA模拟SPI总线后端
+ * @details 板上没有可用的SPI复用功能时，仍然用TDC_SCK/TDC_SI/TDC_SO三根GPIO传输，
+ *          但位时序交给硬件：TIM3每半个SCK周期产生两个DMA请求，
+ *            CH1 (周期开始) -> DMA2 Stream0 把预先算好的波形表依次写入GPIO BSRR，驱动SCK和SI
+ *            CH2 (周期末尾) -> DMA2 Stream1 读取SO所在端口的IDR
+ *          每一位占两个半周期：先SCK拉高同时给出SI (GP22在上升沿输出SO)，再SCK拉低 (GP22采样SI)。
+ *          SO在高电平半周期的末尾采样，传输结束后由CPU从IDR样本中取出各位。
+ *          SSN的建立、保持时间仍由CPU控制，一次事务的位时序与CPU负载和中断无关。
+ *
+ *          要求：
+ *          - TDC_SCK和TDC_SI在同一个GPIO端口
+ *          - 波形表和样本在 .bss 中，必须位于DMA2能访问的存储区 (不能是DTCM)
+ *          - 使用TIM3和DMA2 Stream0/Stream1
+ */
+#ifndef TDC_BBDMA_H__
+#define TDC_BBDMA_H__
+
+#include "main.h"
+#include "tdc_io.h"
+#include "tdc_config.h"
+
+/**
+ * @brief 初始化TIM3和DMA，可以重复调用
+ * @return HAL_OK 成功；HAL_ERROR 引脚不满足要求或半周期太短
+ */
+HAL_StatusTypeDef TDC_BBDMA_Init(void);
+
+/**
+ * @brief 获取后端操作表，供 TDC_IO_Set_Transport() 使用
+ * @note  必须先调用 TDC_BBDMA_Init()
+ */
+const TDC_IO_OpsTypeDef *TDC_BBDMA_Ops(void);
+
+#endif // TDC_BBDMA_H__
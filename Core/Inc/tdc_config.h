@@ -0,0 +1,264 @@
+/*
+ * @file    tdc_config.h
+ * @brief   GP22 TDC驱动配置文件
+ *
+ * 本文件用于配置TDC驱动的编译期参数。
+ * 请根据您的具体硬件和需求进行相应的修改。
+ */
+
+#ifndef TDC_CONFIG_H__
+#define TDC_CONFIG_H__
+
+/**
+ * @brief 默认使用的TDC总线后端 (编译期选择)
+ *
+ * - TDC_TRANSPORT_BITBANG: 软件模拟SPI，使用PD10-PD15上的TDC_SCK/TDC_SI/TDC_SO
+ * - TDC_TRANSPORT_SPI:     硬件SPI外设，需工作在SPI模式1 (CPOL=0, CPHA=1)，软件NSS
+ * - TDC_TRANSPORT_DMA:     TIM3节拍的DMA模拟SPI，引脚与软件模拟SPI相同，位时序由硬件保证
+ * 运行时可以通过 TDC_IO_Set_Transport() 切换。
+ */
+#define TDC_TRANSPORT_DEFAULT TDC_TRANSPORT_BITBANG
+
+/**
+ * @brief 硬件SPI单次片选事务的超时时间 (微秒)
+ *
+ * 事务在关中断下进行，超时用DWT计时。最慢的SCK (240MHz / 256) 传输5个字节约需43us。
+ */
+#define TDC_SPI_TIMEOUT_US 200
+
+/**
+ * @brief 单次片选事务中操作码之后最多携带的数据字节数
+ */
+#define TDC_IO_MAX_PAYLOAD 4
+
+/**
+ * @brief DMA模拟SPI的半个SCK周期，单位纳秒
+ *
+ * 每个半周期有一次DMA写BSRR和一次DMA读IDR，必须大于DMA访问GPIO的延迟加上SO有效延迟。
+ * 100ns对应5MHz的SCK。
+ */
+#define TDC_BBDMA_HALF_NS 100
+
+/**
+ * @brief GP22 SPI与复位时序，单位纳秒
+ *
+ * 取自GP22数据手册 (3.3V供电) 的最小值，SCK最高20MHz。
+ * 软件SPI的所有边沿都按这些值用DWT周期计数器等待，不再依赖循环次数。
+ */
+#define TDC_T_SCK_HIGH_NS    25   // SCK高电平最小宽度
+#define TDC_T_SCK_LOW_NS     25   // SCK低电平最小宽度
+#define TDC_T_SO_VALID_NS    20   // SCK上升沿之后SO数据有效的最大延迟
+#define TDC_T_SSN_SETUP_NS   40   // SSN下降沿到第一个SCK上升沿
+#define TDC_T_SSN_HOLD_NS    40   // 最后一个SCK下降沿到SSN上升沿
+#define TDC_T_SSN_HIGH_NS    50   // 两次事务之间SSN的最小高电平时间
+#define TDC_T_RTN_LOW_NS     50   // RSTN复位脉冲最小宽度
+#define TDC_T_RTN_RECOVER_NS 500  // RSTN释放到第一次SPI访问
+#define TDC_T_EEP_XFER_NS  10000  // EEPROM与配置寄存器之间传送或比较一次，留有余量
+
+/**
+ * @brief START脉冲参数，单位纳秒
+ *
+ * START脉冲由TIM1_CH3 (PA10) 单脉冲模式产生，分辨率为一个TIM1时钟 (240MHz下约4.2ns)。
+ * 脉冲串中相邻两个上升沿的间隔为 TDC_START_PERIOD_NS。
+ */
+#define TDC_START_WIDTH_NS  100   // 脉冲高电平宽度
+#define TDC_START_PERIOD_NS 200   // 脉冲串周期，单脉冲时决定上升沿之前的固定延迟
+
+/**
+ * @brief 高速参考时钟 (陶瓷晶振) 标称频率 (Hz)
+ *
+ * 未完成晶振校准时按这个值换算时间。
+ */
+#define TDC_CLKHS_HZ 4000000
+
+/**
+ * @brief 晶振校准结果的有效期 (毫秒)
+ *
+ * 校准一次需要 ANZ_PER_CALRES 个32.768kHz周期 (默认8个，244.14us)。
+ * 结果缓存后只在到期或调用 TDC_Cal_Invalidate() (如温度变化) 后重新校准，设为0表示不自动刷新。
+ */
+#define TDC_CAL_INTERVAL_MS 10000
+
+/**
+ * @brief 等待一次晶振校准完成的超时时间 (微秒)
+ *
+ * 阻塞测量函数需要校准时按这个值单独等待，测量本身的超时可以设得很短。
+ */
+#define TDC_CAL_TIMEOUT_US 2000
+
+/**
+ * @brief 上电和复位恢复时先从GP22片内EEPROM装载配置
+ *
+ * 设为1时只发送EEPROM_to_Config (0xF0) 并校验，与驱动的配置不一致时再逐字写入全部寄存器。
+ * EEPROM中的配置由 TDC_EEPROM_Store() 写入。
+ */
+#define TDC_EEPROM_BOOT 1
+
+/**
+ * @brief 写入EEPROM等待的时间 (毫秒)
+ */
+#define TDC_EEPROM_WRITE_MS 200
+
+/**
+ * @brief 校准结果与标称值的最大允许偏差 (ppm)，超出则认为校准失败
+ */
+#define TDC_CAL_TOL_PPM 20000
+
+/**
+ * @brief 一次START最多读出的结果个数
+ *
+ * GP22只有4个结果寄存器 (RES_0-RES_3)，STOP1与STOP2的脉冲个数之和不能超过这个值。
+ */
+#define TDC_MAX_HITS 4
+
+/**
+ * @brief 多脉冲读出时等待ALU算完一个结果的最长时间 (纳秒)
+ *
+ * 测量范围1中ALU每次计算不到1us，超过这个时间认为该脉冲没有结果。
+ */
+#define TDC_T_ALU_NS 5000
+
+/**
+ * @brief 连续采集结果环形缓冲区的记录数，必须是2的幂
+ */
+#define TDC_RING_SIZE 256
+
+/**
+ * @brief 连续采集的默认重复频率 (Hz)
+ */
+#define TDC_ACQ_DEFAULT_RATE 1000
+
+/**
+ * @brief 连续采集中一次测量超过这个时间 (us) 仍未完成，就认为TDC_INT丢失并执行恢复
+ *
+ * 必须大于预分频器溢出时间 (64us) 和一次晶振校准的时间 (244.14us)。
+ */
+#define TDC_ACQ_STALL_US 1000
+
+/**
+ * @brief 流水线测量中一次测量超过这个时间 (us) 仍未完成，TDC_Pipeline_Poll() 就执行恢复
+ *
+ * 与 TDC_ACQ_STALL_US 相同，必须大于一次测量的最长时间和一次晶振校准的时间 (244.14us)。
+ */
+#define TDC_PIPE_STALL_US 1000
+
+/**
+ * @brief 连续采集时间统计的窗口样本数
+ */
+#define TDC_STATS_WINDOW 1000
+
+/**
+ * @brief 抖动平均的默认次数
+ */
+#define TDC_AVG_DEFAULT_N 64
+
+/**
+ * @brief 抖动平均的默认相位档数，每档推迟START一个TIM1时钟
+ */
+#define TDC_AVG_DITHER_STEPS 8
+
+/**
+ * @brief GP22测量范围1的量化步长 (一个门延迟)，单位ps
+ *
+ * 数据手册3.3V、25°C下单精度模式的典型值。本驱动不写寄存器6，不使用双精度 (约45ps)
+ * 和四精度 (约22ps) 模式。实际值随电压和温度变化，仅用于报告分辨率。
+ */
+#define TDC_GP22_LSB_PS 90
+
+/**
+ * @brief 按置信区间停止的平均测量中，开始判断前至少需要的样本数
+ *
+ * 样本太少时标准差本身的估计不可靠，区间可能偶然很窄。
+ */
+#define TDC_AVG_MIN_N 8
+
+/**
+ * @brief 分布统计中估计的分位数，单位千分之一
+ */
+#define TDC_DIST_QUANTILES {500, 950, 990}
+#define TDC_DIST_NQ 3
+
+/**
+ * @brief 直方图的箱数
+ */
+#define TDC_HIST_BINS 64
+
+/**
+ * @brief 连续采集直方图的默认箱宽 (ps)，以第一个样本为中心
+ */
+#define TDC_HIST_BIN_PS 20
+
+/**
+ * @brief 滤波器滑动窗口的最大长度，决定每一级的静态内存
+ */
+#define TDC_FILTER_MAX_WIN 31
+
+/**
+ * @brief 滤波器流水线的最大级数
+ */
+#define TDC_FILTER_MAX_STAGES 4
+
+/**
+ * @brief DMA读出模式环形缓冲区的测量次数，必须是偶数，CPU每收满一半处理一次
+ */
+#define TDC_DMA_SHOTS 64
+
+/**
+ * @brief DMA读出模式中TDC_INT的第二路输入
+ *
+ * DMAMUX请求发生器只能由EXTI0触发，TDC_INT需要同时接到一个编号为0的引脚。
+ */
+#define TDC_DMA_INT_PORT GPIOD
+#define TDC_DMA_INT_PIN  GPIO_PIN_0
+
+/**
+ * @brief 混合测量中标记脉冲相对STOP事件捕获的延迟和宽度，单位纳秒
+ *
+ * 延迟保证GP22的START到STOP1不小于测量范围1的下限 (3.5ns)，
+ * 分辨率为一个TIM8时钟 (240MHz下约4.2ns)。
+ */
+#define TDC_HYBRID_MARKER_DELAY_NS 50
+#define TDC_HYBRID_MARKER_WIDTH_NS 50
+
+/**
+ * @brief 混合测量接受的最大时间间隔，单位毫秒
+ *
+ * TIM2捕获值之差按无符号数比较，上限由32位计数器的溢出周期 (240MHz下约17.9s) 决定。
+ * 留出的余量用于识别STOP先于START被捕获的情况 (差值回绕成接近2^32的数)。
+ */
+#define TDC_HYBRID_MAX_MS 17000
+
+/**
+ * @brief 混合测量定时器时钟校准中标记脉冲延迟的增量，单位纳秒
+ *
+ * 校准时标记脉冲先后在原延迟和原延迟加上这个值处各测一组，两组细时间之差就是这段时间
+ * 按GP22 (已做晶振校准) 测得的值。加上原延迟后必须小于测量范围1的上限 (约2.4us)。
+ * 捕获同步的相位在一个定时器时钟内均匀分布，增量越大、每组次数越多，校准越准。
+ */
+#define TDC_HYBRID_CAL_SPAN_NS 2000
+
+/**
+ * @brief 定时器时钟校准结果与标称值的最大允许偏差 (ppm)
+ *
+ * 内核和定时器时钟来自HSI (出厂精度约±1%)，超出这个范围说明接线或测量有误。
+ */
+#define TDC_HYBRID_CLK_TOL_PPM 20000
+
+/**
+ * @brief 遥测流每帧的记录数 (1 - 255)
+ *
+ * 每条记录25字节，1152000波特下32条一帧约7ms，可以持续发送约4500条/秒。
+ */
+#define TDC_STREAM_BATCH 32
+
+/**
+ * @brief 遥测流未满的帧最多等待的时间 (微秒)，超过后不等装满直接发送
+ */
+#define TDC_STREAM_FLUSH_US 20000
+
+/**
+ * @brief 最大支持的TDC芯片数量，TDC_INT中断按这个列表分发
+ */
+#define MAX_TDC_DEVICES 4
+
+#endif // TDC_CONFIG_H__
@@ -0,0 +1,88 @@
+/*
+ * @file    tdc_conv.h
+ * @brief   GP22测量结果的整数时间换算
+ * @details 结果寄存器是以Tref为单位的16.16定点数 (测量范围1为有符号数，测量范围2为无符号数)。
+ *          换算全部使用整数乘法和移位，得到四舍五入到1ps的64位整数，不经过浮点。
+ *          浮点纳秒只作为显示用的最后一步。
+ */
+#ifndef TDC_CONV_H__
+#define TDC_CONV_H__
+
+#include "main.h"
+#include "tdc.h"
+#include "tdc_config.h"
+
+/**
+ * @brief 参考时钟周期 (fs)，div 为寄存器0的 DIV_CLKHS
+ */
+#define TDC_TREF_FS(div) ((uint32_t)((1000000000000000ULL << (div)) / TDC_CLKHS_HZ))
+
+/**
+ * @brief 一个结果LSB (Tref/65536) 对应的皮秒数，Q32定点
+ */
+#define TDC_PS_SCALE(tref_fs) (((uint64_t)(tref_fs) << 16) / 1000U)
+
+/**
+ * @brief 换算系数
+ */
+typedef struct {
+    uint64_t k;         // 一个结果LSB对应的皮秒数，Q32定点
+    uint8_t is_signed;  // 结果是否为有符号数 (测量范围1)
+} TDC_ScaleTypeDef;
+
+/**
+ * @brief 按标称频率换算的编译期系数，测量范围1 (DIV_CLKHS = 1)
+ */
+#define TDC_SCALE_RANGE1_NOMINAL { TDC_PS_SCALE(TDC_TREF_FS(1)), 1 }
+
+/**
+ * @brief 按标称频率换算的编译期系数，测量范围2 (DIV_CLKHS = 0)
+ */
+#define TDC_SCALE_RANGE2_NOMINAL { TDC_PS_SCALE(TDC_TREF_FS(0)), 0 }
+
+/**
+ * @brief 把一个原始结果换算为皮秒
+ * @param raw 结果寄存器的值
+ * @param scale 换算系数
+ * @return 时间，单位皮秒，四舍五入
+ * @note  高16位和低16位分别与系数相乘，两个乘积都不超过51位，不会溢出
+ */
+static inline int64_t TDC_Fixed_to_ps(uint32_t raw, const TDC_ScaleTypeDef *scale)
+{
+    int64_t hi = scale->is_signed ? (int64_t)(int16_t)(raw >> 16) : (int64_t)(raw >> 16);
+    uint64_t lo = raw & 0xFFFF;
+    int64_t t;
+
+    t = hi * (int64_t)scale->k + (int64_t)((lo * scale->k + 0x8000) >> 16);
+    return (t + 0x8000) >> 16;
+}
+
+/**
+ * @brief 皮秒换算为纳秒浮点数，仅用于显示
+ */
+static inline float TDC_ps_to_ns(int64_t ps)
+{
+    return (float)ps * 1e-3f;
+}
+
+/**
+ * @brief 获取当前测量范围和晶振校准结果对应的换算系数
+ * @note  批量换算前取一次，避免每个样本都计算系数
+ */
+void TDC_Get_Scale(TDC_HandleTypeDef *htdc, TDC_ScaleTypeDef *scale);
+
+/**
+ * @brief 按当前换算系数把一个原始结果换算为皮秒
+ */
+int64_t TDC_Raw_to_ps(TDC_HandleTypeDef *htdc, uint32_t raw);
+
+/**
+ * @brief 批量换算
+ * @param raw 原始结果数组
+ * @param ps 输出数组，单位皮秒，可以与记录数据分开存放
+ * @param n 个数
+ * @param scale 换算系数
+ */
+void TDC_Raw_to_ps_Batch(const uint32_t *raw, int64_t *ps, uint32_t n, const TDC_ScaleTypeDef *scale);
+
+#endif // TDC_CONV_H__
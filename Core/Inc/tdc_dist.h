@@ -0,0 +1,81 @@
+/*
+ * @file    tdc_dist.h
+ * @brief   时间间隔的分布统计：流式分位数和定宽直方图
+ * @details 分位数用P²算法估计，每个分位数只保存5个标记，不保存样本；
+ *          直方图箱宽固定，单位ps，超出范围的样本分别计入下溢和上溢。
+ *          每个样本O(1)更新，内存大小固定。与 tdc_stats 一样用序号锁保护，
+ *          生产者在中断里更新，TFT和串口在主循环里取快照。
+ */
+#ifndef TDC_DIST_H__
+#define TDC_DIST_H__
+
+#include "main.h"
+#include "tdc_config.h"
+
+/**
+ * @brief P²分位数估计器
+ * @note  q[2] 是目标分位数的估计，q[0]、q[4] 是最小值和最大值
+ */
+typedef struct {
+    int64_t q[5];          // 标记高度，单位ps，Q4定点
+    int64_t n[5];          // 标记实际位置 (从1开始)
+    int64_t np_q16[5];     // 标记期望位置，Q16定点
+    uint32_t dn_q16[5];    // 每个样本期望位置的增量，Q16定点
+    uint32_t count;        // 样本数
+} TDC_P2TypeDef;
+
+/**
+ * @brief 分布统计对象
+ */
+typedef struct {
+    TDC_P2TypeDef p2[TDC_DIST_NQ];
+    uint32_t bins[TDC_HIST_BINS];
+    uint32_t under;               // 小于直方图下限的样本数
+    uint32_t over;                // 大于直方图上限的样本数
+    int64_t lo_ps;                // 直方图下限
+    uint32_t bin_ps;              // 箱宽
+    uint8_t auto_center;          // 1表示以清零后的第一个样本为直方图中心
+    uint32_t n;                   // 样本数
+    volatile uint32_t seq;        // 序号锁，奇数表示正在更新
+} TDC_DistTypeDef;
+
+/**
+ * @brief 分布快照
+ */
+typedef struct {
+    uint32_t n;                         // 样本数
+    uint16_t p[TDC_DIST_NQ];            // 分位数，单位千分之一
+    int64_t q_q4[TDC_DIST_NQ];          // 分位数估计，单位ps，Q4定点
+    int64_t lo_ps;                      // 直方图下限，第i箱为 [lo + i*bin, lo + (i+1)*bin)
+    uint32_t bin_ps;                    // 箱宽
+    uint32_t bins[TDC_HIST_BINS];
+    uint32_t under;
+    uint32_t over;
+} TDC_DistSnapshotTypeDef;
+
+/**
+ * @brief 初始化分布统计，分位数取 TDC_DIST_QUANTILES
+ * @param lo_ps 直方图下限，auto_center为1时忽略
+ * @param bin_ps 箱宽，不能为0
+ * @param auto_center 1表示以第一个样本为直方图中心
+ */
+void TDC_Dist_Init(TDC_DistTypeDef *d, int64_t lo_ps, uint32_t bin_ps, uint8_t auto_center);
+
+/**
+ * @brief 清零，保留直方图设置
+ * @note  可以在生产者运行时从主循环调用
+ */
+void TDC_Dist_Reset(TDC_DistTypeDef *d);
+
+/**
+ * @brief 加入一个样本 (生产者)
+ * @param ps 样本，单位ps
+ */
+void TDC_Dist_Add(TDC_DistTypeDef *d, int64_t ps);
+
+/**
+ * @brief 取得一致的快照 (消费者)
+ */
+void TDC_Dist_Snapshot(const TDC_DistTypeDef *d, TDC_DistSnapshotTypeDef *snap);
+
+#endif // TDC_DIST_H__
@@ -0,0 +1,77 @@
+/*
+ * @file    tdc_dma.h
+ * @brief   由TDC_INT触发的DMA结果读出，不需要CPU参与
+ * @details TDC_INT的下降沿经EXTI0送入DMAMUX请求发生器，依次触发一串预先配置好的DMA传输：
+ *            1. SSN拉低 (写GPIO BSRR)，同时清除EXTI0的挂起标志
+ *            2. 向SPI发送读RES_0操作码和4个空字节
+ *            3. SPI收到的5个字节写入环形缓冲区
+ *            4. SSN拉高
+ *          各步之间由DMAMUX通道事件衔接，GP22开启EN_FAST_INIT，收到中断后自行准备下一次测量，
+ *          不需要发送Init。START由TIM4触发TIM1硬件产生。
+ *          CPU只在环形缓冲区收满一半和收满全部时被唤醒，这是GP22能达到的最高测量速率的途径。
+ *
+ *          要求：
+ *          - TDC使用硬件SPI后端 (TDC_Init_Instance() 中给出SPI句柄)，SPI工作在模式1，8位数据
+ *          - TDC_INT同时接到 TDC_DMA_INT_PORT / TDC_DMA_INT_PIN (编号为0的引脚)
+ *          - 使用DMA1 Stream1-5 和DMAMUX1请求发生器0-3，与连续采集不能同时使用
+ */
+#ifndef TDC_DMA_H__
+#define TDC_DMA_H__
+
+#include "main.h"
+#include "tdc.h"
+#include "tdc_config.h"
+
+#if (TDC_DMA_SHOTS & 1) != 0 || TDC_DMA_SHOTS == 0
+#error "TDC_DMA_SHOTS must be a non-zero even number"
+#endif
+
+/**
+ * @brief 一批结果的回调，在DMA中断中调用
+ * @param raw 原始结果 (RES_0)，只在回调期间有效
+ * @param n 结果个数，等于 TDC_DMA_SHOTS / 2
+ */
+typedef void (*TDC_DMA_BlockCallbackTypeDef)(const uint32_t *raw, uint32_t n);
+
+/**
+ * @brief DMA读出计数
+ */
+typedef struct {
+    uint32_t blocks;     // 处理过的半个缓冲区个数
+    uint32_t shots;      // 读出的结果个数
+    uint32_t errors;     // DMA传输错误次数
+} TDC_DMAStatsTypeDef;
+
+/**
+ * @brief 开始DMA读出
+ * @param htdc 进行测量的TDC，必须使用硬件SPI后端
+ * @param rate_hz START脉冲频率，单位Hz
+ * @param block_cb 每收满半个缓冲区调用一次，可以为NULL
+ * @return HAL_OK 已启动；HAL_ERROR 不是硬件SPI后端、频率无效或DMA配置失败；
+ *         HAL_BUSY 测量进行中，或连续采集 (tdc_acq.h) 正在使用TIM4
+ * @note  TDC设置为测量范围1、STOP1单脉冲、EN_FAST_INIT，TDC_INT的EXTI中断被屏蔽
+ */
+HAL_StatusTypeDef TDC_DMA_Start(TDC_HandleTypeDef *htdc, uint32_t rate_hz, TDC_DMA_BlockCallbackTypeDef block_cb);
+
+/**
+ * @brief 停止DMA读出，恢复TDC_INT中断和TDC配置
+ */
+void TDC_DMA_Stop(void);
+
+/**
+ * @brief 查询DMA读出是否进行中
+ * @return 1表示进行中
+ */
+uint8_t TDC_DMA_Is_Running(void);
+
+/**
+ * @brief 获取DMA读出计数
+ */
+void TDC_DMA_Get_Stats(TDC_DMAStatsTypeDef *stats);
+
+/**
+ * @brief 结果DMA (DMA1 Stream2) 中断处理
+ */
+void TDC_DMA_IRQHandler(void);
+
+#endif // TDC_DMA_H__
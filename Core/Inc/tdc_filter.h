@@ -0,0 +1,142 @@
+/*
+ * @file    tdc_filter.h
+ * @brief   测量结果的静态滤波流水线
+ * @details 最多 TDC_FILTER_MAX_STAGES 级串联，每一级可以是滑动中值、Hampel离群值剔除、EMA或一维卡尔曼跟踪。
+ *          全部使用定点整数，内存在结构体中静态分配，不调用malloc。
+ *          中值和Hampel每个样本 O(log w)，EMA和卡尔曼 O(1)，可以在主循环中按采集速率处理环形缓冲区中的每一条记录。
+ */
+#ifndef TDC_FILTER_H__
+#define TDC_FILTER_H__
+
+#include "main.h"
+#include "tdc_config.h"
+
+/**
+ * @brief 滤波器类型
+ */
+typedef enum {
+    TDC_FILTER_MEDIAN = 0, // 滑动中值
+    TDC_FILTER_HAMPEL = 1, // 以中值和MAD判断离群值
+    TDC_FILTER_EMA    = 2, // 指数滑动平均
+    TDC_FILTER_KALMAN = 3, // 一维卡尔曼 (随机游走模型)
+} TDC_FilterKindTypeDef;
+
+/**
+ * @brief 滑动中值 (双堆)
+ * @note  heap 以 w/2 为中点：负下标是最大堆，0是中值，正下标是最小堆。
+ *        新样本替换窗口中最旧的样本后只在所在的堆里上浮或下沉。
+ */
+typedef struct {
+    int64_t data[TDC_FILTER_MAX_WIN];  // 按到达顺序的环形窗口
+    int8_t pos[TDC_FILTER_MAX_WIN];    // 每个样本在堆中的位置
+    int8_t heap[TDC_FILTER_MAX_WIN];   // 堆中保存样本在data中的下标
+    uint8_t w;                         // 窗口长度
+    uint8_t idx;                       // 下一个写入位置
+    uint8_t ct;                        // 窗口中的样本数
+} TDC_MedianTypeDef;
+
+/**
+ * @brief Hampel离群值判断
+ * @note  以窗口中值为中心，以偏差的滑动中值 (MAD) 估计分散程度，
+ *        |x - 中值| > k * 1.4826 * MAD 时判为离群值。判断新样本而不是窗口中心，没有延迟。
+ *        1.4826 * MAD 小于一个GP22量化步长 TDC_GP22_LSB_PS 时按一个量化步长计算，
+ *        MAD为0时不会把相邻一档的结果判为离群值，也不会关闭判断。
+ */
+typedef struct {
+    TDC_MedianTypeDef value;           // 样本窗口
+    TDC_MedianTypeDef dev;             // 偏差窗口
+    uint32_t k_q8;                     // 门限系数，Q8定点
+    uint8_t drop;                      // 1: 丢弃离群值；0: 用中值代替
+} TDC_HampelTypeDef;
+
+/**
+ * @brief 指数滑动平均 y += (x - y) / 2^shift
+ */
+typedef struct {
+    int64_t y_q8;                      // 输出，单位ps，Q8定点
+    uint8_t shift;
+    uint8_t init;
+} TDC_EmaTypeDef;
+
+/**
+ * @brief 一维卡尔曼跟踪
+ */
+typedef struct {
+    int64_t x_q8;                      // 估计值，单位ps，Q8定点
+    uint64_t p_q8;                     // 估计方差，单位ps^2，Q8定点
+    uint64_t q_q8;                     // 过程噪声方差，即每个样本之间真实值的变化
+    uint64_t r_q8;                     // 测量噪声方差
+    uint8_t init;
+} TDC_KalmanTypeDef;
+
+/**
+ * @brief 流水线中的一级
+ */
+typedef struct {
+    TDC_FilterKindTypeDef kind;
+    union {
+        TDC_MedianTypeDef median;
+        TDC_HampelTypeDef hampel;
+        TDC_EmaTypeDef ema;
+        TDC_KalmanTypeDef kalman;
+    } u;
+} TDC_FilterStageTypeDef;
+
+/**
+ * @brief 滤波流水线
+ */
+typedef struct {
+    TDC_FilterStageTypeDef stage[TDC_FILTER_MAX_STAGES];
+    uint8_t count;                     // 级数
+    uint32_t in;                       // 输入样本数
+    uint32_t out;                      // 输出样本数
+    uint32_t outliers;                 // Hampel判出的离群值个数
+} TDC_FilterTypeDef;
+
+/**
+ * @brief 初始化为空流水线，空流水线原样输出
+ */
+void TDC_Filter_Init(TDC_FilterTypeDef *f);
+
+/**
+ * @brief 清空各级的状态，保留配置
+ */
+void TDC_Filter_Reset(TDC_FilterTypeDef *f);
+
+/**
+ * @brief 追加滑动中值
+ * @param w 窗口长度，1 - TDC_FILTER_MAX_WIN
+ * @return HAL_OK 追加成功；HAL_ERROR 参数错误或级数已满
+ */
+HAL_StatusTypeDef TDC_Filter_Add_Median(TDC_FilterTypeDef *f, uint8_t w);
+
+/**
+ * @brief 追加Hampel离群值剔除
+ * @param w 窗口长度，3 - TDC_FILTER_MAX_WIN，窗口填满之前不做判断
+ * @param k_q8 门限系数，Q8定点，常用3.0 (768)
+ * @param drop 1表示丢弃离群值，0表示用窗口中值代替
+ */
+HAL_StatusTypeDef TDC_Filter_Add_Hampel(TDC_FilterTypeDef *f, uint8_t w, uint32_t k_q8, uint8_t drop);
+
+/**
+ * @brief 追加指数滑动平均
+ * @param shift 平滑系数为 1/2^shift，1 - 16
+ */
+HAL_StatusTypeDef TDC_Filter_Add_EMA(TDC_FilterTypeDef *f, uint8_t shift);
+
+/**
+ * @brief 追加一维卡尔曼跟踪
+ * @param q_ps2 过程噪声方差，单位ps^2，被测时间缓慢漂移的程度
+ * @param r_ps2 测量噪声方差，单位ps^2，约为单次测量标准差的平方
+ */
+HAL_StatusTypeDef TDC_Filter_Add_Kalman(TDC_FilterTypeDef *f, uint32_t q_ps2, uint32_t r_ps2);
+
+/**
+ * @brief 处理一个样本
+ * @param in 输入，单位ps
+ * @param out 输出，单位ps
+ * @return 1表示有输出；0表示样本被丢弃
+ */
+uint8_t TDC_Filter_Process(TDC_FilterTypeDef *f, int64_t in, int64_t *out);
+
+#endif // TDC_FILTER_H__
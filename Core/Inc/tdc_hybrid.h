@@ -0,0 +1,98 @@
+/*
+ * @file    tdc_hybrid.h
+ * @brief   TIM2输入捕获粗计数与GP22细时间相结合的大量程测量
+ * @details TIM2是32位自由运行计数器 (240MHz，约4.2ns一个时钟，约17.9s溢出)，
+ *          CH2捕获START脉冲，CH1捕获STOP事件。CH1的捕获同时经TIM2_TRGO触发TIM8，
+ *          在捕获之后固定的D个时钟发出一个标记脉冲，与定时器时钟同步。
+ *          GP22 (测量范围1) 以STOP事件为START、以标记脉冲为STOP1，测出事件到标记的时间 fine，
+ *          合成结果为
+ *              T = (CCR1 - CCR2) * Ttim + D * Ttim - fine - offset
+ *          量程取决于32位计数器，上限为 TDC_HYBRID_MAX_MS，分辨率取决于GP22，
+ *          一次START测完，不需要切换测量范围。
+ *          offset为两路捕获的同步延迟之差等固定偏差，用零长度 (START直接接STOP) 测得。
+ *
+ *          定时器时钟来自HSI (出厂精度约±1%)，按标称时钟换算时粗计数部分的误差与间隔成正比，
+ *          10us的间隔就有约100ns，GP22的细时间没有意义。使用前应调用
+ *          TDC_Hybrid_Calibrate_Clock()，以GP22晶振校准后的Tref为基准测出定时器的实际时钟。
+ *
+ *          硬件连接：
+ *          - START脉冲 TIM1_CH3 (PA10) 同时接 TIM2_CH2 (PA1)
+ *          - STOP事件接 TIM2_CH1 (PA0) 和 GP22 START
+ *          - TIM8_CH1 (PC6) 标记脉冲接 GP22 STOP1
+ */
+#ifndef TDC_HYBRID_H__
+#define TDC_HYBRID_H__
+
+#include "main.h"
+#include "tdc.h"
+
+/**
+ * @brief 混合测量结果
+ */
+typedef struct {
+    uint32_t coarse;      // STOP与START捕获值之差，TIM2时钟数
+    int64_t fine_ps;      // GP22测得的STOP事件到标记脉冲的时间
+    int64_t ps;           // 合成的START到STOP时间，已扣除offset
+} TDC_HybridResultTypeDef;
+
+/**
+ * @brief 初始化混合测量
+ * @param htdc 进行细测量的TDC，设置为STOP1单脉冲
+ * @return HAL_OK 初始化成功；HAL_ERROR 定时器配置失败或TDC不在测量范围1；HAL_BUSY 测量进行中
+ * @note  占用TDC的完成回调，不能与 TDC_Acq_Start() 连续采集同时使用
+ */
+HAL_StatusTypeDef TDC_Hybrid_Init(TDC_HandleTypeDef *htdc);
+
+/**
+ * @brief 停止混合测量，释放TDC的完成回调
+ */
+void TDC_Hybrid_DeInit(TDC_HandleTypeDef *htdc);
+
+/**
+ * @brief 设置零点偏差
+ * @param offset_ps 零长度时测得的结果，以后的结果都减去这个值
+ */
+void TDC_Hybrid_Set_Offset(int64_t offset_ps);
+
+/**
+ * @brief 启动一次混合测量，立即返回
+ * @return HAL_OK 已发出START；HAL_BUSY 上一次测量尚未完成；HAL_ERROR START脉冲发生器忙
+ */
+HAL_StatusTypeDef TDC_Hybrid_Start_IT(TDC_HandleTypeDef *htdc);
+
+/**
+ * @brief 取出最近一次完成的混合测量结果
+ * @param res 测量结果
+ * @return HAL_OK 取到有效结果；HAL_BUSY 没有新结果；
+ *         HAL_ERROR 有新结果但无效 (捕获缺失、STOP多于一个边沿、间隔超过 TDC_HYBRID_MAX_MS 或GP22没有结果)
+ */
+HAL_StatusTypeDef TDC_Hybrid_Get_Result(TDC_HybridResultTypeDef *res);
+
+/**
+ * @brief 用GP22校准定时器时钟
+ * @param htdc 已由 TDC_Hybrid_Init() 初始化的TDC
+ * @param n 每组测量次数，标记延迟的两个取值各测一组，建议1000以上
+ * @param timeout_us 单次测量超时，单位微秒
+ * @return HAL_OK 校准成功；HAL_TIMEOUT 没有STOP事件；HAL_BUSY 测量进行中；
+ *         HAL_ERROR 晶振校准失败、测量出错过多或结果超出 TDC_HYBRID_CLK_TOL_PPM
+ * @note  每次START都必须有一个STOP事件，按测零点偏差的方式把START直接接STOP即可。
+ *        校准结果只影响混合测量的换算，失败时保留原来的值。
+ *        TIM1由同一个PLL驱动，偏差可以通过 TDC_Hybrid_Get_Clock_Error() 交给其他模块。
+ */
+HAL_StatusTypeDef TDC_Hybrid_Calibrate_Clock(TDC_HandleTypeDef *htdc, uint32_t n, uint32_t timeout_us);
+
+/**
+ * @brief 获取定时器时钟相对标称值的偏差
+ * @param err_ppb 偏差，单位ppb，实际时钟 = 标称时钟 * (1 + err_ppb / 10^9)
+ * @return HAL_OK 已校准；HAL_ERROR 还没有校准，err_ppb为0
+ */
+HAL_StatusTypeDef TDC_Hybrid_Get_Clock_Error(int32_t *err_ppb);
+
+/**
+ * @brief 进行一次混合测量 (阻塞方式)
+ * @param timeout_us 超时时间，单位微秒，必须大于START到STOP的时间
+ * @return HAL_OK 测量成功；HAL_TIMEOUT 超时 (没有STOP事件)；HAL_ERROR 结果无效；HAL_BUSY 测量进行中
+ */
+HAL_StatusTypeDef TDC_Hybrid_Measure(TDC_HandleTypeDef *htdc, TDC_HybridResultTypeDef *res, uint32_t timeout_us);
+
+#endif // TDC_HYBRID_H__
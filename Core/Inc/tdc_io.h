@@ -0,0 +1,103 @@
+/*
+ * @file    tdc_io.h
+ * @brief   GP22 TDC底层总线驱动头文件
+ * @details 把操作码和数据放在一次片选事务中发送，底层可以是软件模拟SPI、硬件SPI或DMA模拟SPI。
+ *          多片GP22共用SCK/SI/SO，各自使用独立的SSN，由 TDC_HandleTypeDef 区分。
+ */
+#ifndef TDC_IO_H__
+#define TDC_IO_H__
+
+#include "main.h"
+#include "spi.h"
+#include "tdc_config.h"
+#include "dwt.h"
+
+/**
+ * @brief TDC句柄，完整定义见 tdc.h
+ */
+typedef struct __TDC_HandleTypeDef TDC_HandleTypeDef;
+
+/**
+ * @brief TDC总线后端类型
+ */
+typedef enum {
+    TDC_TRANSPORT_BITBANG = 0, // 软件模拟SPI
+    TDC_TRANSPORT_SPI     = 1, // 硬件SPI外设
+    TDC_TRANSPORT_DMA     = 2, // 定时器节拍的DMA模拟SPI，见 tdc_bbdma.h
+    TDC_TRANSPORT_COUNT
+} TDC_TransportTypeDef;
+
+/**
+ * @brief 总线后端操作表
+ * @note  transfer 完成一次完整的片选事务：拉低SSN，发送操作码，
+ *        然后发送 tx 或接收到 rx (二者只用其一，另一个为NULL)，最后拉高SSN。
+ */
+typedef struct {
+    const char *name;
+    void (*transfer)(TDC_HandleTypeDef *htdc, uint8_t opcode, const uint8_t *tx, uint8_t *rx, uint8_t len);
+} TDC_IO_OpsTypeDef;
+
+/**
+ * @brief 初始化TDC总线，选择编译期默认后端
+ * @param htdc TDC句柄，使用其中的SPI句柄 (可以为NULL) 和SSN引脚
+ */
+void TDC_IO_Init(TDC_HandleTypeDef *htdc);
+
+/**
+ * @brief 运行时切换总线后端
+ * @param transport 目标后端
+ * @return HAL_OK 切换成功；HAL_ERROR 后端不可用 (未提供SPI句柄或SPI不是8位主机模式1，DMA模拟SPI的引脚或定时不满足要求)
+ */
+HAL_StatusTypeDef TDC_IO_Set_Transport(TDC_HandleTypeDef *htdc, TDC_TransportTypeDef transport);
+
+/**
+ * @brief 获取当前使用的总线后端
+ */
+TDC_TransportTypeDef TDC_IO_Get_Transport(TDC_HandleTypeDef *htdc);
+
+/**
+ * @brief 完成一次片选事务：操作码 + len字节数据
+ * @param opcode 操作码
+ * @param tx 待发送的数据，读操作时为NULL
+ * @param rx 接收缓冲区，写操作时为NULL
+ * @param len 数据字节数，不超过 TDC_IO_MAX_PAYLOAD
+ * @note  事务期间关闭中断，其他芯片的TDC_INT中断不会在共用总线上插入传输
+ */
+void TDC_IO_Transfer(TDC_HandleTypeDef *htdc, uint8_t opcode, const uint8_t *tx, uint8_t *rx, uint8_t len);
+
+/**
+ * @brief 发送单字节操作码 (如 0x50 上电复位、0x70 初始化)
+ */
+void TDC_IO_Write8(TDC_HandleTypeDef *htdc, uint8_t opcode);
+
+/**
+ * @brief 写入32位字，最高字节为操作码，低24位为寄存器数据
+ * @param word 例如 0x80009420
+ */
+void TDC_IO_Write32(TDC_HandleTypeDef *htdc, uint32_t word);
+
+/**
+ * @brief 发送读操作码并读回8位数据
+ */
+uint8_t TDC_IO_Read8(TDC_HandleTypeDef *htdc, uint8_t opcode);
+
+/**
+ * @brief 发送读操作码并读回16位数据 (如 0xB4 状态寄存器)
+ */
+uint16_t TDC_IO_Read16(TDC_HandleTypeDef *htdc, uint8_t opcode);
+
+/**
+ * @brief 发送读操作码并读回32位数据
+ */
+uint32_t TDC_IO_Read32(TDC_HandleTypeDef *htdc, uint8_t opcode);
+
+/**
+ * @brief 测量某个总线后端读取一个32位寄存器的平均耗时
+ * @param transport 要测试的后端，测试后恢复原来的后端
+ * @param n 传输次数
+ * @return 每次传输的平均耗时，单位纳秒；后端不可用时返回0
+ * @note  使用DWT周期计数器计时，单次测量总时长不能超过计数器回绕周期 (480MHz下约8.9秒)
+ */
+uint32_t TDC_IO_Benchmark(TDC_HandleTypeDef *htdc, TDC_TransportTypeDef transport, uint32_t n);
+
+#endif // TDC_IO_H__
@@ -0,0 +1,91 @@
+/*
+ * @file    tdc_pulse.h
+ * @brief   TIM1_CH3 (PA10) 硬件定时START脉冲
+ * @details 单脉冲模式产生固定宽度、固定相位的START脉冲，
+ *          利用重复计数器一次发出多个脉冲组成脉冲串，发出过程不需要CPU参与。
+ */
+#ifndef TDC_PULSE_H__
+#define TDC_PULSE_H__
+
+#include "main.h"
+
+/**
+ * @brief START脉冲触发源
+ */
+typedef enum {
+    TDC_PULSE_TRIG_SOFTWARE = 0, // TDC_Pulse_Fire() 立即发出
+    TDC_PULSE_TRIG_TIM4     = 1, // TIM4更新事件 (TRGO) 触发，相位由TIM4决定
+} TDC_PulseTrigTypeDef;
+
+/**
+ * @brief 初始化START脉冲发生器，使用 tdc_config.h 中的默认宽度和周期
+ * @note  必须在 MX_TIM1_Init() 之后调用
+ */
+HAL_StatusTypeDef TDC_Pulse_Init(void);
+
+/**
+ * @brief 设置脉冲宽度和脉冲串周期
+ * @param width_ns 高电平宽度，单位纳秒
+ * @param period_ns 周期，单位纳秒，必须大于宽度
+ * @return HAL_OK 设置成功；HAL_ERROR 参数超出TIM1范围；HAL_BUSY 脉冲正在输出或处于TIM4触发模式
+ */
+HAL_StatusTypeDef TDC_Pulse_Config(uint32_t width_ns, uint32_t period_ns);
+
+/**
+ * @brief 推迟脉冲上升沿，用于START相位抖动
+ * @param ticks 相对 TDC_Pulse_Config() 设定位置推迟的TIM1时钟数，0恢复原位
+ * @return HAL_OK 设置成功；HAL_ERROR 超出TIM1范围；HAL_BUSY 脉冲正在输出或处于TIM4触发模式
+ * @note  TDC_Pulse_Config() 会把延迟清零
+ */
+HAL_StatusTypeDef TDC_Pulse_Set_Delay(uint32_t ticks);
+
+/**
+ * @brief 选择触发源
+ * @return HAL_OK 设置成功；HAL_BUSY 脉冲正在输出
+ * @note  退出TIM4触发模式时先停止TIM4，再重试到不返回HAL_BUSY为止，
+ *        此后不会再有TRGO在两次脉冲之间启动计数器
+ */
+HAL_StatusTypeDef TDC_Pulse_Set_Trigger(TDC_PulseTrigTypeDef trig);
+
+/**
+ * @brief 发出一个脉冲或一串脉冲
+ * @param count 脉冲个数，1-65536
+ * @return HAL_OK 已启动；HAL_BUSY 上一串脉冲尚未结束；HAL_ERROR 参数错误
+ * @note  触发源为TIM4时，本函数只是装好脉冲个数，此后每个TRGO都发出这么多个脉冲
+ */
+HAL_StatusTypeDef TDC_Pulse_Fire(uint32_t count);
+
+/**
+ * @brief 查询脉冲是否正在输出或等待触发
+ * @return 1 计数器在运行，或处于TIM4触发模式 (两次触发之间CEN为0，但随时可能开始输出)
+ * @note  忙时 TDC_Pulse_Config() 和 TDC_Pulse_Set_Delay() 返回HAL_BUSY，
+ *        不会在两次TIM4触发之间改动ARR/CCR
+ */
+uint8_t TDC_Pulse_Is_Busy(void);
+
+/**
+ * @brief 设置TIM1时钟相对标称值的偏差
+ * @param err_ppb 偏差，单位ppb，实际时钟 = 标称时钟 * (1 + err_ppb / 10^9)
+ * @note  TIM1与TIM2/TIM8由同一个PLL驱动，偏差取自 TDC_Hybrid_Get_Clock_Error()。
+ *        只影响 TDC_Pulse_Tick_ps() / TDC_Pulse_Tick_fs()，脉冲宽度和周期仍按标称时钟设置
+ */
+void TDC_Pulse_Set_Clock_Error(int32_t err_ppb);
+
+/**
+ * @brief 查询TIM1时钟是否已经校准
+ * @return 1 已调用 TDC_Pulse_Set_Clock_Error()；0 时钟长度只是标称值 (HSI约±1%)
+ */
+uint8_t TDC_Pulse_Clock_Is_Calibrated(void);
+
+/**
+ * @brief TIM1一个计数时钟对应的皮秒数
+ */
+uint32_t TDC_Pulse_Tick_ps(void);
+
+/**
+ * @brief TIM1一个计数时钟对应的飞秒数，用于精确扣除START延迟
+ * @note  未校准时按标称时钟计算
+ */
+uint32_t TDC_Pulse_Tick_fs(void);
+
+#endif // TDC_PULSE_H__
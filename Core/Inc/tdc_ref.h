@@ -0,0 +1,64 @@
+/*
+ * @file    tdc_ref.h
+ * @brief   STOP2参考通道的漂移补偿
+ * @details STOP2接一个已知的固定延迟 (同一个START经过延迟线或定长电缆)，STOP1接被测信号，
+ *          每个START同时测出两个通道 (TDC_Set_Hits(htdc, 1, 1))。START通路、比较器和温度
+ *          引起的延迟漂移对两个通道相同，从STOP1中减去参考通道测得值与已知值之差即可抵消，
+ *          不需要停下来重新校准，全速连续测量时长期保持准确。
+ *          只用整数运算，可以在TDC_INT中断中调用。
+ */
+#ifndef TDC_REF_H__
+#define TDC_REF_H__
+
+#include "main.h"
+#include "tdc.h"
+
+#define TDC_REF_AUTO INT64_MIN  // 参考延迟未知，以清除后第一次测得的值为基准
+
+/**
+ * @brief 参考通道补偿状态
+ */
+typedef struct {
+    int64_t ref_ps;       // 参考延迟的已知值，单位ps
+    int64_t drift_q8;     // 参考通道漂移 (测得值 - 已知值) 的平滑值，单位ps，Q8定点
+    uint8_t shift;        // 平滑系数为 1/2^shift，0表示逐次扣除
+    uint8_t init;         // 已有漂移估计
+    uint8_t auto_ref;     // ref_ps由测量得到，每次清除后重新学习
+    uint32_t count;       // 参考通道有效的测量次数
+    uint32_t missing;     // 参考通道缺失的测量次数，按上一次的漂移估计补偿
+} TDC_RefTypeDef;
+
+/**
+ * @brief 初始化参考通道补偿
+ * @param ref_ps 参考延迟的已知值 (ps)，TDC_REF_AUTO表示以第一次测得的值为基准，只补偿此后的漂移
+ * @param shift 漂移的平滑系数，0 - 16
+ * @note  shift为0时逐次扣除，START抖动等共模噪声也一起抵消，但参考通道自身的噪声会叠加到结果中；
+ *        漂移很慢时取较大的shift，结果的噪声几乎不增加
+ */
+void TDC_Ref_Init(TDC_RefTypeDef *ref, int64_t ref_ps, uint8_t shift);
+
+/**
+ * @brief 清除漂移估计，保留设置
+ * @note  ref_ps由测量得到时一并清除，下一次参考通道的结果成为新的基准
+ */
+void TDC_Ref_Reset(TDC_RefTypeDef *ref);
+
+/**
+ * @brief 换算一次START的结果并扣除参考通道漂移
+ * @param htdc 进行测量的TDC，STOP1和STOP2各接收至少1个脉冲
+ * @param hits 测量结果，STOP1第一个脉冲为被测时间，STOP2第一个脉冲为参考时间
+ * @param ps 输出补偿后的STOP1时间，单位ps
+ * @return 1表示已补偿；0表示还没有漂移估计，输出未补偿的值；STOP1没有结果时不输出并返回0
+ */
+uint8_t TDC_Ref_Correct(TDC_RefTypeDef *ref, TDC_HandleTypeDef *htdc, const TDC_HitsTypeDef *hits, int64_t *ps);
+
+/**
+ * @brief 当前的漂移估计
+ * @return 参考通道测得值与已知值之差，单位ps
+ */
+static inline int64_t TDC_Ref_Get_Drift(const TDC_RefTypeDef *ref)
+{
+    return (ref->drift_q8 + 128) >> 8;
+}
+
+#endif // TDC_REF_H__
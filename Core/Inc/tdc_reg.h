@@ -0,0 +1,185 @@
+/*
+ * @file    tdc_reg.h
+ * @brief   GP22配置寄存器的结构化描述
+ * @details 寄存器0-5用结构体按字段描述，由 TDC_Config_Pack() 打包成 write32() 使用的6个写入字
+ *          (最高字节为写操作码 0x80+n，低24位对应寄存器的31:8位)。
+ *          配置为常量时打包在编译期完成。
+ */
+#ifndef TDC_REG_H__
+#define TDC_REG_H__
+
+#include "main.h"
+
+/**
+ * @brief 配置写入字个数 (寄存器0-5)
+ */
+#define TDC_CFG_WORDS 6
+
+/**
+ * @brief 寄存器n的写操作码放在写入字最高字节
+ */
+#define TDC_REG_OPCODE(n) ((uint32_t)(0x80U + (n)) << 24)
+
+/**
+ * @brief 把字段放到写入字中：width为位宽，bit为字段最低位在寄存器中的位置
+ */
+#define TDC_FIELD(v, width, bit) (((uint32_t)(v) & ((1UL << (width)) - 1)) << ((bit) - 8))
+
+/**
+ * @brief 寄存器0：时钟、校准与测量范围
+ */
+typedef struct {
+    uint8_t anz_fire;        // 31:28 FIRE脉冲个数
+    uint8_t div_fire;        // 27:24 FIRE时钟分频
+    uint8_t anz_per_calres;  // 23:22 晶振校准周期数，2 << n 个32.768kHz周期
+    uint8_t div_clkhs;       // 21:20 参考时钟分频，Tref = 2^n / CLKHS
+    uint8_t start_clkhs;     // 19:18 高速晶振起振方式，1为上电后一直起振
+    uint8_t anz_port;        // 17
+    uint8_t tcycle;          // 16
+    uint8_t anz_fake;        // 15
+    uint8_t sel_eclk_tmp;    // 14
+    uint8_t calibrate;       // 13 ALU输出校准后的结果
+    uint8_t no_cal_auto;     // 12 测量后不自动校准TDC
+    uint8_t messb2;          // 11 测量范围2
+    uint8_t neg_stop2;       // 10 STOP2下降沿敏感
+    uint8_t neg_stop1;       // 9  STOP1下降沿敏感
+    uint8_t neg_start;       // 8  START下降沿敏感
+} TDC_Reg0TypeDef;
+
+/**
+ * @brief 寄存器1：ALU运算数与期望脉冲数
+ */
+typedef struct {
+    uint8_t hit2;            // 31:28 ALU运算的减数
+    uint8_t hit1;            // 27:24 ALU运算的被减数
+    uint8_t en_fast_init;    // 23
+    uint8_t rsvd;            // 22 厂家例程中测量范围2置1
+    uint8_t hitin2;          // 21:19 STOP2期望脉冲数
+    uint8_t hitin1;          // 18:16 STOP1期望脉冲数
+    uint8_t curr32k;         // 15
+    uint8_t sel_start_fire;  // 14
+    uint8_t sel_tsto2;       // 13:11
+    uint8_t sel_tsto1;       // 10:8
+} TDC_Reg1TypeDef;
+
+/**
+ * @brief 寄存器2：中断源与STOP1延迟窗口
+ */
+typedef struct {
+    uint8_t en_int;          // 31:29 中断源：ALU完成、收齐脉冲、溢出
+    uint8_t rfedge2;         // 28 STOP2双沿敏感
+    uint8_t rfedge1;         // 27 STOP1双沿敏感
+    uint32_t delval1;        // 26:8
+} TDC_Reg2TypeDef;
+
+/**
+ * @brief 寄存器3：溢出时间与STOP2延迟窗口
+ */
+typedef struct {
+    uint8_t en_autocalc_mb;  // 31
+    uint8_t en_first_wave;   // 30
+    uint8_t en_err_val;      // 29
+    uint8_t sel_timo_mb;     // 28:27 预分频器溢出时间
+    uint32_t delval2;        // 26:8
+} TDC_Reg3TypeDef;
+
+/**
+ * @brief 寄存器4
+ */
+typedef struct {
+    uint8_t rsvd;            // 31:27 固定为 0b00100
+    uint32_t delval3;        // 26:8
+} TDC_Reg4TypeDef;
+
+/**
+ * @brief 寄存器5：FIRE脉冲与相位
+ */
+typedef struct {
+    uint8_t conf_fire;       // 31:29
+    uint8_t en_startnoise;   // 28
+    uint8_t dis_phaseshift;  // 27
+    uint8_t repeat_fire;     // 26:24
+    uint16_t phase_fire;     // 23:8
+} TDC_Reg5TypeDef;
+
+/**
+ * @brief GP22完整配置
+ */
+typedef struct {
+    TDC_Reg0TypeDef reg0;
+    TDC_Reg1TypeDef reg1;
+    TDC_Reg2TypeDef reg2;
+    TDC_Reg3TypeDef reg3;
+    TDC_Reg4TypeDef reg4;
+    TDC_Reg5TypeDef reg5;
+} TDC_ConfigTypeDef;
+
+/**
+ * @brief 测量范围1，STOP1-START，打包结果为
+ *        0x80009420 0x81010100 0x82E00000 0x83080000 0x84200000 0x85080000
+ */
+#define TDC_CONFIG_RANGE1_DEFAULT {                                                           \
+    .reg0 = { .anz_per_calres = 2, .div_clkhs = 1, .start_clkhs = 1, .calibrate = 1 },         \
+    .reg1 = { .hit2 = 0, .hit1 = 1, .hitin1 = 1 },                                             \
+    .reg2 = { .en_int = 7 },          /* 开启所有中断源 */                                      \
+    .reg3 = { .sel_timo_mb = 1 },     /* 溢出预划分器64us */                                    \
+    .reg4 = { .rsvd = 4 },                                                                     \
+    .reg5 = { .dis_phaseshift = 1 },                                                           \
+}
+
+/**
+ * @brief 测量范围2，STOP1-START，寄存器0、1打包结果为 0x80008468 0x81214200
+ */
+#define TDC_CONFIG_RANGE2_DEFAULT {                                                           \
+    .reg0 = { .anz_per_calres = 2, .div_clkhs = 0, .start_clkhs = 1,                          \
+              .sel_eclk_tmp = 1, .calibrate = 1, .messb2 = 1 },                                \
+    .reg1 = { .hit2 = 2, .hit1 = 1, .rsvd = 1, .hitin1 = 2 },                                  \
+    .reg2 = { .en_int = 7 },                                                                   \
+    .reg3 = { .sel_timo_mb = 1 },                                                              \
+    .reg4 = { .rsvd = 4 },                                                                     \
+    .reg5 = { .dis_phaseshift = 1 },                                                           \
+}
+
+/**
+ * @brief 把配置打包成6个写入字
+ * @param cfg 配置
+ * @param word 输出，word[n] 可直接用于 write32()
+ */
+static inline void TDC_Config_Pack(const TDC_ConfigTypeDef *cfg, uint32_t word[TDC_CFG_WORDS])
+{
+    word[0] = TDC_REG_OPCODE(0) |
+              TDC_FIELD(cfg->reg0.anz_fire, 4, 28) | TDC_FIELD(cfg->reg0.div_fire, 4, 24) |
+              TDC_FIELD(cfg->reg0.anz_per_calres, 2, 22) | TDC_FIELD(cfg->reg0.div_clkhs, 2, 20) |
+              TDC_FIELD(cfg->reg0.start_clkhs, 2, 18) | TDC_FIELD(cfg->reg0.anz_port, 1, 17) |
+              TDC_FIELD(cfg->reg0.tcycle, 1, 16) | TDC_FIELD(cfg->reg0.anz_fake, 1, 15) |
+              TDC_FIELD(cfg->reg0.sel_eclk_tmp, 1, 14) | TDC_FIELD(cfg->reg0.calibrate, 1, 13) |
+              TDC_FIELD(cfg->reg0.no_cal_auto, 1, 12) | TDC_FIELD(cfg->reg0.messb2, 1, 11) |
+              TDC_FIELD(cfg->reg0.neg_stop2, 1, 10) | TDC_FIELD(cfg->reg0.neg_stop1, 1, 9) |
+              TDC_FIELD(cfg->reg0.neg_start, 1, 8);
+
+    word[1] = TDC_REG_OPCODE(1) |
+              TDC_FIELD(cfg->reg1.hit2, 4, 28) | TDC_FIELD(cfg->reg1.hit1, 4, 24) |
+              TDC_FIELD(cfg->reg1.en_fast_init, 1, 23) | TDC_FIELD(cfg->reg1.rsvd, 1, 22) |
+              TDC_FIELD(cfg->reg1.hitin2, 3, 19) | TDC_FIELD(cfg->reg1.hitin1, 3, 16) |
+              TDC_FIELD(cfg->reg1.curr32k, 1, 15) | TDC_FIELD(cfg->reg1.sel_start_fire, 1, 14) |
+              TDC_FIELD(cfg->reg1.sel_tsto2, 3, 11) | TDC_FIELD(cfg->reg1.sel_tsto1, 3, 8);
+
+    word[2] = TDC_REG_OPCODE(2) |
+              TDC_FIELD(cfg->reg2.en_int, 3, 29) | TDC_FIELD(cfg->reg2.rfedge2, 1, 28) |
+              TDC_FIELD(cfg->reg2.rfedge1, 1, 27) | TDC_FIELD(cfg->reg2.delval1, 19, 8);
+
+    word[3] = TDC_REG_OPCODE(3) |
+              TDC_FIELD(cfg->reg3.en_autocalc_mb, 1, 31) | TDC_FIELD(cfg->reg3.en_first_wave, 1, 30) |
+              TDC_FIELD(cfg->reg3.en_err_val, 1, 29) | TDC_FIELD(cfg->reg3.sel_timo_mb, 2, 27) |
+              TDC_FIELD(cfg->reg3.delval2, 19, 8);
+
+    word[4] = TDC_REG_OPCODE(4) |
+              TDC_FIELD(cfg->reg4.rsvd, 5, 27) | TDC_FIELD(cfg->reg4.delval3, 19, 8);
+
+    word[5] = TDC_REG_OPCODE(5) |
+              TDC_FIELD(cfg->reg5.conf_fire, 3, 29) | TDC_FIELD(cfg->reg5.en_startnoise, 1, 28) |
+              TDC_FIELD(cfg->reg5.dis_phaseshift, 1, 27) | TDC_FIELD(cfg->reg5.repeat_fire, 3, 24) |
+              TDC_FIELD(cfg->reg5.phase_fire, 16, 8);
+}
+
+#endif // TDC_REG_H__
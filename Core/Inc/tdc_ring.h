@@ -0,0 +1,77 @@
+/*
+ * @file    tdc_ring.h
+ * @brief   TDC测量记录的单生产者/单消费者无锁环形缓冲区
+ * @details 生产者是测量完成中断，消费者是主循环。两端各自只写自己的索引，
+ *          不需要关中断。缓冲区满时丢弃新记录并计入溢出计数。
+ */
+#ifndef TDC_RING_H__
+#define TDC_RING_H__
+
+#include "main.h"
+#include "tdc_config.h"
+#include "tdc.h"
+
+#if (TDC_RING_SIZE & (TDC_RING_SIZE - 1)) != 0
+#error "TDC_RING_SIZE must be a power of two"
+#endif
+
+/**
+ * @brief 测量记录所属的STOP通道
+ */
+typedef enum {
+    TDC_CH_STOP1 = 0,
+    TDC_CH_STOP2 = 1,
+    TDC_CH_COUNT
+} TDC_ChannelTypeDef;
+
+/**
+ * @brief 一条测量记录
+ * @note  双通道模式下一次START产生两条记录 (每个收到脉冲的通道一条)，序号和时间戳相同
+ */
+typedef struct {
+    uint32_t seq;         // 测量序号 (START次数)，从0开始连续递增，溢出丢弃的记录也占用序号
+    uint32_t timestamp;   // START时刻的DWT周期计数
+    uint8_t ch;           // 通道，TDC_ChannelTypeDef，单通道模式下总是 TDC_CH_STOP1
+    uint8_t valid;        // ps有效；0表示本通道没有结果，或参考通道补偿还没有漂移估计
+    uint8_t ref;          // 记录产生时开启了参考通道补偿，ps为补偿后的值
+    TDC_HitsTypeDef hits; // 本次START的全部原始测量结果
+    int64_t ps;           // 本通道第一个结果换算后的时间 (ps)，开启参考通道补偿时为补偿后的值
+} TDC_RecordTypeDef;
+
+/**
+ * @brief 环形缓冲区
+ */
+typedef struct {
+    TDC_RecordTypeDef buf[TDC_RING_SIZE];
+    volatile uint32_t head;     // 写索引，只由生产者修改
+    volatile uint32_t tail;     // 读索引，只由消费者修改
+    volatile uint32_t overrun;  // 因缓冲区满被丢弃的记录数
+} TDC_RingTypeDef;
+
+/**
+ * @brief 清空环形缓冲区
+ * @note  只能在生产者停止时调用
+ */
+void TDC_Ring_Reset(TDC_RingTypeDef *ring);
+
+/**
+ * @brief 写入一条记录 (生产者)
+ * @return 1表示写入成功，0表示缓冲区已满，记录被丢弃
+ */
+uint8_t TDC_Ring_Push(TDC_RingTypeDef *ring, const TDC_RecordTypeDef *rec);
+
+/**
+ * @brief 取出一条记录 (消费者)
+ * @return 1表示取到记录，0表示缓冲区为空
+ */
+uint8_t TDC_Ring_Pop(TDC_RingTypeDef *ring, TDC_RecordTypeDef *rec);
+
+/**
+ * @brief 当前缓冲区中的记录数
+ */
+static inline uint32_t TDC_Ring_Count(const TDC_RingTypeDef *ring)
+{
+    return ring->head - ring->tail;
+}
+
+#endif // TDC_RING_H__
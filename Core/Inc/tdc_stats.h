@@ -0,0 +1,97 @@
+/*
+ * @file    tdc_stats.h
+ * @brief   TDC测量结果的流式统计 (Welford均值/方差、最小/最大值)
+ * @details 全部使用定点整数，不分配内存，每个样本O(1)更新。
+ *          同时保存累计统计和按样本数分段的窗口统计。
+ *          生产者 (中断) 更新时用序号锁保护，消费者 (主循环) 随时可以取得一致的快照。
+ */
+#ifndef TDC_STATS_H__
+#define TDC_STATS_H__
+
+#include "main.h"
+
+/**
+ * @brief Welford累加器
+ */
+typedef struct {
+    uint32_t n;         // 样本数
+    int64_t mean_q16;   // 均值，单位ps，Q16定点
+    uint64_t m2_q8;     // 与均值之差的平方和，单位ps^2，Q8定点
+    int64_t min;        // 最小值，单位ps
+    int64_t max;        // 最大值，单位ps
+} TDC_WelfordTypeDef;
+
+/**
+ * @brief 统计对象
+ */
+typedef struct {
+    TDC_WelfordTypeDef life;      // 累计统计
+    TDC_WelfordTypeDef win;       // 当前窗口
+    TDC_WelfordTypeDef last_win;  // 上一个完整窗口
+    uint32_t window;              // 窗口样本数，0表示不分窗口
+    uint32_t windows;             // 已完成的窗口数
+    volatile uint32_t seq;        // 序号锁，奇数表示正在更新
+} TDC_StatsTypeDef;
+
+/**
+ * @brief 统计快照
+ */
+typedef struct {
+    TDC_WelfordTypeDef life;
+    TDC_WelfordTypeDef win;
+    TDC_WelfordTypeDef last_win;
+    uint32_t windows;
+} TDC_StatsSnapshotTypeDef;
+
+/**
+ * @brief 由累加器计算出的结果
+ */
+typedef struct {
+    uint32_t n;        // 样本数
+    int64_t mean_q4;   // 均值，单位ps，Q4定点 (1/16 ps)
+    uint32_t std_q4;   // 样本标准差，单位ps，Q4定点
+    uint32_t sem_q4;   // 均值的标准误差 std/sqrt(n)，单位ps，Q4定点
+    int64_t min;       // 最小值，单位ps
+    int64_t max;       // 最大值，单位ps
+} TDC_StatsResultTypeDef;
+
+/**
+ * @brief 初始化统计对象
+ * @param window 窗口样本数，0表示只做累计统计
+ */
+void TDC_Stats_Init(TDC_StatsTypeDef *st, uint32_t window);
+
+/**
+ * @brief 清零累计和窗口统计，O(1)
+ * @note  可以在生产者运行时从主循环调用
+ */
+void TDC_Stats_Reset(TDC_StatsTypeDef *st);
+
+/**
+ * @brief 加入一个样本 (生产者)
+ * @param ps 样本，单位ps
+ */
+void TDC_Stats_Add(TDC_StatsTypeDef *st, int64_t ps);
+
+/**
+ * @brief 取得一致的快照 (消费者)
+ */
+void TDC_Stats_Snapshot(const TDC_StatsTypeDef *st, TDC_StatsSnapshotTypeDef *snap);
+
+/**
+ * @brief 清零一个累加器
+ */
+void TDC_Welford_Reset(TDC_WelfordTypeDef *w);
+
+/**
+ * @brief 累加器加入一个样本，不加锁，只能由一个上下文使用
+ * @param ps 样本，单位ps
+ */
+void TDC_Welford_Add(TDC_WelfordTypeDef *w, int64_t ps);
+
+/**
+ * @brief 由累加器计算均值、标准差等结果
+ */
+void TDC_Welford_Result(const TDC_WelfordTypeDef *w, TDC_StatsResultTypeDef *res);
+
+#endif // TDC_STATS_H__
@@ -0,0 +1,91 @@
+/*
+ * @file    tdc_stream.h
+ * @brief   测量记录的USART二进制遥测流
+ * @details 主循环从采集环形缓冲区取出的记录不格式化为文本，直接按小端二进制打包，
+ *          多条记录组成一帧，加CRC后做COBS编码，以0x00结束，由DMA发送到USART1。
+ *          两个编码缓冲区轮流使用：一个由DMA发送时，另一个可以装入下一帧，CPU不等待串口。
+ *
+ *          帧格式 (COBS编码之前，多字节字段均为小端)：
+ *            偏移  长度  字段
+ *            0     1     类型，TDC_STREAM_TYPE_RECORDS
+ *            1     1     本帧记录数 n
+ *            2     2     帧序号，每帧加1，主机据此发现丢帧
+ *            4     2     上一帧之后因缓冲区满而丢弃的记录数
+ *            6     2     每微秒的内核周期数，用于换算记录中的时间戳
+ *            8     25*n  记录
+ *            8+25n 2     CRC-16/CCITT-FALSE (多项式0x1021，初值0xFFFF)，覆盖前面全部字节
+ *
+ *          记录格式：
+ *            0     4     测量序号 (START次数)，与 TDC_RecordTypeDef.seq 相同
+ *            4     4     START时刻的DWT周期计数
+ *            8     1     通道，TDC_ChannelTypeDef
+ *            9     1     本次START的结果个数，0表示没有结果
+ *            10    2     GP22状态寄存器
+ *            12    4     本通道第一个原始结果
+ *            16    8     换算后的时间 (ps)，有符号
+ *            24    1     标志：bit0 TDC_STREAM_FLAG_VALID 时间有效，
+ *                        bit1 TDC_STREAM_FLAG_REF 时间已经过参考通道补偿，其余位为0
+ *
+ *          标志bit0为0时时间字段没有意义 (本通道没有结果，或参考通道补偿还没有漂移估计)，
+ *          主机不能把它当作0ps的测量值。
+ */
+#ifndef TDC_STREAM_H__
+#define TDC_STREAM_H__
+
+#include "main.h"
+#include "tdc.h"
+#include "tdc_ring.h"
+#include "tdc_config.h"
+
+#define TDC_STREAM_TYPE_RECORDS 0x01
+
+#define TDC_STREAM_HEADER_SIZE 8
+#define TDC_STREAM_RECORD_SIZE 25
+#define TDC_STREAM_CRC_SIZE    2
+
+#define TDC_STREAM_FLAG_VALID  0x01  // TDC_RecordTypeDef.valid
+#define TDC_STREAM_FLAG_REF    0x02  // TDC_RecordTypeDef.ref
+
+/**
+ * @brief 遥测流计数
+ */
+typedef struct {
+    uint32_t records;    // 已装入帧的记录数
+    uint32_t frames;     // 已发送完成的帧数
+    uint32_t dropped;    // 两个缓冲区都被占用而丢弃的记录数
+    uint32_t errors;     // DMA传输错误次数
+} TDC_StreamStatsTypeDef;
+
+/**
+ * @brief 初始化遥测流
+ * @param htdc 记录所属的TDC，用于找到STOP2结果的位置
+ * @param huart 已由 MX_USART1_UART_Init() 初始化的串口
+ * @return HAL_OK 成功；HAL_ERROR DMA初始化失败
+ * @note  使用DMA1 Stream6
+ */
+HAL_StatusTypeDef TDC_Stream_Init(TDC_HandleTypeDef *htdc, UART_HandleTypeDef *huart);
+
+/**
+ * @brief 加入一条记录，帧装满 TDC_STREAM_BATCH 条时交给DMA发送
+ * @return 1 成功；0 缓冲区都被占用，记录被丢弃
+ * @note  在主循环中调用
+ */
+uint8_t TDC_Stream_Push(const TDC_RecordTypeDef *rec);
+
+/**
+ * @brief 未满的帧等待超过 TDC_STREAM_FLUSH_US 时发送出去
+ * @note  在主循环中周期调用，测量速率很低时记录也能及时送到主机
+ */
+void TDC_Stream_Poll(void);
+
+/**
+ * @brief 获取遥测流计数
+ */
+void TDC_Stream_Get_Stats(TDC_StreamStatsTypeDef *stats);
+
+/**
+ * @brief 发送DMA中断处理
+ */
+void TDC_Stream_IRQHandler(void);
+
+#endif // TDC_STREAM_H__
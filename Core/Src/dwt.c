@@ -0,0 +1,63 @@
+/**
+ * @file    dwt.c
+ * @brief   基于DWT周期计数器的精确延时实现
+ */
+#include "dwt.h"
+
+uint32_t g_dwt_cycles_per_ns_q16 = 1 << 16;  // 未初始化时按1GHz处理，延时只会偏长
+uint32_t g_dwt_overhead_cycles = 0;
+uint32_t g_dwt_cycles_per_us = 1000;
+
+static uint32_t g_dwt_wraps = 0;   // 周期计数器回绕次数
+static uint32_t g_dwt_last = 0;    // 上一次读到的周期计数
+
+/**
+ * @brief 初始化DWT周期计数器并校准延时参数
+ */
+void DWT_Init(void)
+{
+    uint32_t start, cost;
+
+    SystemCoreClockUpdate();
+
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->LAR = 0xC5ACCE55;  // Cortex-M7 需要先解锁DWT寄存器
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+    g_dwt_wraps = 0;
+    g_dwt_last = 0;
+
+    g_dwt_cycles_per_ns_q16 = (uint32_t)(((uint64_t)SystemCoreClock << 16) / 1000000000U);
+    if (g_dwt_cycles_per_ns_q16 == 0)
+        g_dwt_cycles_per_ns_q16 = 1;
+    g_dwt_cycles_per_us = SystemCoreClock / 1000000U;
+    if (g_dwt_cycles_per_us == 0)
+        g_dwt_cycles_per_us = 1;
+
+    // 校准：测量零延时调用本身的开销，之后从每次延时中扣除
+    g_dwt_overhead_cycles = 0;
+    start = DWT->CYCCNT;
+    DWT_Delay_ns(0);
+    cost = DWT->CYCCNT - start;
+    g_dwt_overhead_cycles = cost;
+}
+
+/**
+ * @brief 读取64位周期计数
+ * @note  读出的计数小于上一次时说明计数器回绕了一次；关中断保证回绕只被计一次
+ */
+uint64_t DWT_Cycles64(void)
+{
+    uint32_t primask = __get_PRIMASK();
+    uint32_t now, wraps;
+
+    __disable_irq();
+    now = DWT->CYCCNT;
+    if (now < g_dwt_last)
+        g_dwt_wraps++;
+    g_dwt_last = now;
+    wraps = g_dwt_wraps;
+    __set_PRIMASK(primask);
+
+    return ((uint64_t)wraps << 32) | now;
+}
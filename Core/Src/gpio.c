@@ -57,9 +57,6 @@ void MX_GPIO_Init(void)
   /*Configure GPIO pin Output Level */
   HAL_GPIO_WritePin(GPIOD, TDC_SCK_Pin|TDC_SSN_Pin|TDC_RTN_Pin|TDC_SI_Pin, GPIO_PIN_RESET);
 
-  /*Configure GPIO pin Output Level */
-  HAL_GPIO_WritePin(PULSE_GPIO_Port, PULSE_Pin, GPIO_PIN_RESET);
-
   /*Configure GPIO pins : TFT_BL_Pin TFT_CS_Pin TFT_DC_Pin TFT_RES_Pin */
   GPIO_InitStruct.Pin = TFT_BL_Pin|TFT_CS_Pin|TFT_DC_Pin|TFT_RES_Pin;
   GPIO_InitStruct.Mode = GPIO_MODE_OUTPUT_PP;
@@ -71,21 +68,24 @@ void MX_GPIO_Init(void)
   GPIO_InitStruct.Pin = TDC_SCK_Pin|TDC_SSN_Pin|TDC_RTN_Pin|TDC_SI_Pin;
   GPIO_InitStruct.Mode = GPIO_MODE_OUTPUT_PP;
   GPIO_InitStruct.Pull = GPIO_NOPULL;
-  GPIO_InitStruct.Speed = GPIO_SPEED_FREQ_LOW;
+  GPIO_InitStruct.Speed = GPIO_SPEED_FREQ_HIGH;
   HAL_GPIO_Init(GPIOD, &GPIO_InitStruct);
 
-  /*Configure GPIO pins : TDC_INT_Pin TDC_SO_Pin */
-  GPIO_InitStruct.Pin = TDC_INT_Pin|TDC_SO_Pin;
-  GPIO_InitStruct.Mode = GPIO_MODE_INPUT;
+  /*Configure GPIO pin : TDC_INT_Pin */
+  GPIO_InitStruct.Pin = TDC_INT_Pin;
+  GPIO_InitStruct.Mode = GPIO_MODE_IT_FALLING;
   GPIO_InitStruct.Pull = GPIO_NOPULL;
-  HAL_GPIO_Init(GPIOD, &GPIO_InitStruct);
+  HAL_GPIO_Init(TDC_INT_GPIO_Port, &GPIO_InitStruct);
 
-  /*Configure GPIO pin : PULSE_Pin */
-  GPIO_InitStruct.Pin = PULSE_Pin;
-  GPIO_InitStruct.Mode = GPIO_MODE_OUTPUT_PP;
+  /*Configure GPIO pin : TDC_SO_Pin */
+  GPIO_InitStruct.Pin = TDC_SO_Pin;
+  GPIO_InitStruct.Mode = GPIO_MODE_INPUT;
   GPIO_InitStruct.Pull = GPIO_NOPULL;
-  GPIO_InitStruct.Speed = GPIO_SPEED_FREQ_LOW;
-  HAL_GPIO_Init(PULSE_GPIO_Port, &GPIO_InitStruct);
+  HAL_GPIO_Init(TDC_SO_GPIO_Port, &GPIO_InitStruct);
+
+  /* EXTI interrupt init*/
+  HAL_NVIC_SetPriority(EXTI15_10_IRQn, 0, 0);
+  HAL_NVIC_EnableIRQ(EXTI15_10_IRQn);
 
 }
 
@@ -38,11 +38,19 @@
 #include "TFTh/TFT_text.h"
 #include "TFTh/TFT_init.h"
 #include "tdc.h"
+#include "tdc_io.h"
+#include "dwt.h"
+#include "tdc_acq.h"
+#include "tdc_pulse.h"
+#include "tdc_conv.h"
+#include "tdc_filter.h"
+#include "tdc_stream.h"
 /* USER CODE END Includes */
 
 /* Private typedef -----------------------------------------------------------*/
 /* USER CODE BEGIN PTD */
 TFT_HandleTypeDef htft1 ;
+TDC_HandleTypeDef htdc1;
 /* USER CODE END PTD */
 
 /* Private define ------------------------------------------------------------*/
@@ -72,6 +80,9 @@ char str5[50];
 char str6[50];
 char str7[50];
 char str8[50];
+// 第一个STOP时间的滤波流水线
+TDC_FilterTypeDef tdc_filter;
+int64_t filtered_ps = 0;
 /* USER CODE END PV */
 
 /* Private function prototypes -----------------------------------------------*/
@@ -126,6 +137,7 @@ int main(void)
   SystemClock_Config();
 
   /* USER CODE BEGIN SysInit */
+  DWT_Init(); // 依赖内核时钟，必须在时钟配置之后
 
   /* USER CODE END SysInit */
 
@@ -136,37 +148,87 @@ int main(void)
   MX_SPI2_Init();
   MX_TIM4_Init();
   MX_SPI3_Init();
+  MX_TIM1_Init();
   /* USER CODE BEGIN 2 */
   // 初始化TFT显示
   TFT_Demo_Init();
   TFT_Fill_Area(&htft1, 0, 0, 320, 240, BLACK);
   int nums = 0;
 
-  TDC_Init();
+  TDC_Pulse_Init(); // 所有TDC共用的START脉冲
+  TDC_Init_Instance(&htdc1, NULL, TDC_SSN_GPIO_Port, TDC_SSN_Pin); // 板上TDC引脚没有硬件SPI复用，使用默认的软件SPI
+  TDC_Config_Pins(&htdc1, TDC_INT_GPIO_Port, TDC_INT_Pin, TDC_RTN_GPIO_Port, TDC_RTN_Pin);
+  TDC_IO_Init(&htdc1);
+  TDC_Init(&htdc1);
+#ifdef DEBUG
+  // 调试版比较各总线后端读一个32位寄存器的耗时，不可用的后端显示0
+  sprintf(str8,"io-ns bb:%lu spi:%lu dma:%lu",
+          (unsigned long)TDC_IO_Benchmark(&htdc1, TDC_TRANSPORT_BITBANG, 1000),
+          (unsigned long)TDC_IO_Benchmark(&htdc1, TDC_TRANSPORT_SPI, 1000),
+          (unsigned long)TDC_IO_Benchmark(&htdc1, TDC_TRANSPORT_DMA, 1000));
+  TFT_Show_String(&htft1,20,180,str8,WHITE,BLACK,16,0);
+#endif
+  TDC_Filter_Init(&tdc_filter);
+  TDC_Filter_Add_Hampel(&tdc_filter, 15, 3 * 256, 1); // 丢弃3倍MAD以外的离群值
+  TDC_Filter_Add_Kalman(&tdc_filter, 1, 8100);        // 单次标准差约90ps
+  // TDC_Acq_Set_Reference(&htdc1, TDC_REF_AUTO, 6); // STOP2接参考延迟时开启漂移补偿
+  // TDC_Acq_Set_Dual(&htdc1);                  // STOP1、STOP2各接一路被测信号时开启双通道测量
+  TDC_Stream_Init(&htdc1, &huart1);            // 每条记录以二进制帧从USART1发给主机
+  TDC_Acq_Start(&htdc1, TDC_ACQ_DEFAULT_RATE); // TIM4定时触发连续采集
   /* USER CODE END 2 */
 
   /* Infinite loop */
   /* USER CODE BEGIN WHILE */
   while (1)
   {
-    uint32_t* result = 0;
-    HAL_Delay(1);
-    //TDC_Measure(result,100) ;
-    nums++;
-    // 将TDC测量结果转换为纳秒
-
-    //float time_ns = MYTDC_to_ns(*result);
+    TDC_RecordTypeDef rec;
+    TDC_AcqStatsTypeDef stats;
+    TDC_StatsSnapshotTypeDef snap;
+    TDC_StatsResultTypeDef res;
+    static TDC_DistSnapshotTypeDef dist;
+    uint8_t updated = 0;
+
+    // 取出所有新记录，屏幕只显示最后一条
+    while (TDC_Acq_Read(&rec))
+    {
+      nums++;
+      updated = 1;
+      TDC_Stream_Push(&rec);
+      if (rec.ch == TDC_CH_STOP1 && rec.valid)
+        TDC_Filter_Process(&tdc_filter, rec.ps, &filtered_ps);
+    }
+    TDC_Stream_Poll();
 
     TFT_Show_String(&htft1,20,20,"Hello world",WHITE,BLACK,16,0);
-    TDC_Measure(result,100);
-    float time = TDC_to_ns(*result);
-    sprintf(str1,"time-ns:%f",time);
-    TFT_Show_String(&htft1,20,40,str1,WHITE,BLACK,16,0);
-    sprintf(str2,"nums:%d",nums);
-    TFT_Show_String(&htft1,20,60,str2,WHITE,BLACK,16,0);
-
-    //sprintf(str3,"time_sss:%f",time_ns);
-    //TFT_Show_String(&htft1,20,80,str3,WHITE,BLACK,16,0);
+
+    if (updated)
+    {
+      // 将TDC测量结果转换为纳秒
+      float time = TDC_to_ns(&htdc1, rec.hits.raw[0]);
+      sprintf(str1,"time-ns:%f hits:%d",time,rec.hits.count);
+      TFT_Show_String(&htft1,20,40,str1,WHITE,BLACK,16,0);
+      sprintf(str2,"nums:%d",nums);
+      TFT_Show_String(&htft1,20,60,str2,WHITE,BLACK,16,0);
+
+      TDC_Acq_Get_Stats(&stats);
+      sprintf(str3,"miss:%lu ovr:%lu",stats.missed,stats.overrun);
+      TFT_Show_String(&htft1,20,80,str3,WHITE,BLACK,16,0);
+
+      // 上一个完整窗口的均值和标准差
+      TDC_Acq_Get_Time_Stats(&snap);
+      TDC_Welford_Result(&snap.last_win, &res);
+      sprintf(str4,"avg-ps:%ld std-ps:%lu",(long)(res.mean_q4 >> 4),(unsigned long)(res.std_q4 >> 4));
+      TFT_Show_String(&htft1,20,100,str4,WHITE,BLACK,16,0);
+      sprintf(str5,"min:%ld max:%ld",(long)res.min,(long)res.max);
+      TFT_Show_String(&htft1,20,120,str5,WHITE,BLACK,16,0);
+      sprintf(str6,"flt-ps:%ld out:%lu",(long)filtered_ps,(unsigned long)tdc_filter.outliers);
+      TFT_Show_String(&htft1,20,140,str6,WHITE,BLACK,16,0);
+
+      // 抖动分布：p50/p95/p99
+      TDC_Acq_Get_Dist(&dist);
+      sprintf(str7,"p50:%ld p95:%ld p99:%ld",(long)(dist.q_q4[0] >> 4),(long)(dist.q_q4[1] >> 4),(long)(dist.q_q4[2] >> 4));
+      TFT_Show_String(&htft1,20,160,str7,WHITE,BLACK,16,0);
+    }
 
     /* USER CODE END WHILE */
 
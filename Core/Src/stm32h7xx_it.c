@@ -22,6 +22,10 @@
 #include "stm32h7xx_it.h"
 /* Private includes ----------------------------------------------------------*/
 /* USER CODE BEGIN Includes */
+#include "tdc.h"
+#include "tdc_dma.h"
+#include "tdc_stream.h"
+#include "dwt.h"
 /* USER CODE END Includes */
 
 /* Private typedef -----------------------------------------------------------*/
@@ -189,7 +193,7 @@ void SysTick_Handler(void)
   /* USER CODE END SysTick_IRQn 0 */
   HAL_IncTick();
   /* USER CODE BEGIN SysTick_IRQn 1 */
-
+  (void)DWT_Cycles64();  // 每毫秒读一次，64位时基不会漏掉周期计数器的回绕
   /* USER CODE END SysTick_IRQn 1 */
 }
 
@@ -228,6 +232,21 @@ void TIM4_IRQHandler(void)
   /* USER CODE END TIM4_IRQn 1 */
 }
 
+/**
+  * @brief This function handles EXTI line[15:10] interrupts.
+  */
+void EXTI15_10_IRQHandler(void)
+{
+  /* USER CODE BEGIN EXTI15_10_IRQn 0 */
+  TDC_EXTI_IRQHandler(); // 分发给TDC_INT在EXTI10-15上的所有芯片，下面只处理剩下的引脚
+
+  /* USER CODE END EXTI15_10_IRQn 0 */
+  HAL_GPIO_EXTI_IRQHandler(TDC_INT_Pin);
+  /* USER CODE BEGIN EXTI15_10_IRQn 1 */
+
+  /* USER CODE END EXTI15_10_IRQn 1 */
+}
+
 /**
   * @brief This function handles SPI3 global interrupt.
   */
@@ -244,4 +263,20 @@ void SPI3_IRQHandler(void)
 
 /* USER CODE BEGIN 1 */
 
+/**
+  * @brief This function handles DMA1 stream2 global interrupt (TDC DMA readout).
+  */
+void DMA1_Stream2_IRQHandler(void)
+{
+  TDC_DMA_IRQHandler();
+}
+
+/**
+  * @brief This function handles DMA1 stream6 global interrupt (USART1 telemetry TX).
+  */
+void DMA1_Stream6_IRQHandler(void)
+{
+  TDC_Stream_IRQHandler();
+}
+
 /* USER CODE END 1 */
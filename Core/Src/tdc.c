@@ -1,9 +1,9 @@
-#include "main.h"
-
-/**
- * @brief 飞秒系数，用于计算最终时间
- */
-#define Fe9 (4e6/2/1e9)
+#include "tdc.h"
+#include "tdc_io.h"
+#include "dwt.h"
+#include "tdc_pulse.h"
+#include "tdc_conv.h"
+#include <string.h>
 
 /**
  * @brief 类型定义简写，提高代码可读性
@@ -21,188 +21,180 @@ typedef uint32_t u32;
 /**
  * @brief GPIO控制宏定义
  */
-#define SSN(x) HAL_GPIO_WritePin(TDC_SSN_GPIO_Port, TDC_SSN_Pin, x)
-#define SCK(x) HAL_GPIO_WritePin(TDC_SCK_GPIO_Port, TDC_SCK_Pin, x)
-#define SI(x)  HAL_GPIO_WritePin(TDC_SI_GPIO_Port, TDC_SI_Pin, x)
-#define RTN(x) HAL_GPIO_WritePin(TDC_RTN_GPIO_Port, TDC_RTN_Pin, x)
+#define RTN(h, x) HAL_GPIO_WritePin((h)->rtn_port, (h)->rtn_pin, x)
 
 /**
- * @brief GPIO读取宏定义
+ * @brief 寄存器访问，操作码和数据在同一次片选事务中发送
  */
-#define SO()   HAL_GPIO_ReadPin(TDC_SO_GPIO_Port, TDC_SO_Pin)
-#define INT()  HAL_GPIO_ReadPin(TDC_INT_GPIO_Port, TDC_INT_Pin)
+#define write8(h, op)    TDC_IO_Write8(h, op)
+#define write32(h, word) TDC_IO_Write32(h, word)
 
 /**
- * @brief 简单延时函数
- * @param t 延时参数，影响延时时间
+ * @brief 寄存器1中ALU运算数在写入字中的位置，读出多个结果时直接改写影子寄存器的这两个字段
  */
-void delay(uint8_t t) {
-    volatile uint32_t delay = t * 500;
-    while (delay > 0) {
-        delay--;
-    }
-}
+#define REG1_HIT2(x)   TDC_FIELD(x, 4, 28)  // ALU运算的减数
+#define REG1_HIT1(x)   TDC_FIELD(x, 4, 24)  // ALU运算的被减数
 
 /**
- * @brief 发送1位
- * @note 生成时钟上升沿并发送高电平
+ * @brief HIT1/HIT2 运算数编码
  */
-void send1(void) {
-    SCK(1);
-    delay(1);
-    SI(1);
-    delay(1);
-    SCK(0);
-    delay(1);
-    //delay(1);
-}
+#define HIT_START   0          // START
+#define HIT_CH1(n)  (n)        // STOP1第n个脉冲 (1-4)
+#define HIT_CH2(n)  (8 + (n))  // STOP2第n个脉冲 (1-4)
 
 /**
- * @brief 发送0位
- * @note 生成时钟上升沿并发送低电平
+ * @brief 状态寄存器字段
  */
-void send0(void) {
-    SCK(1);
-    delay(1);
-    SI(0);
-    delay(1);
-    SCK(0);
-    delay(1);
-    //delay(1);
-}
+#define STAT_PTR(s)  ((s) & 0x7)         // 结果寄存器指针，即已算出的结果个数
+#define STAT_HIT1(s) (((s) >> 3) & 0x7)  // STOP1收到的脉冲数
+#define STAT_HIT2(s) (((s) >> 6) & 0x7)  // STOP2收到的脉冲数
+
+#define IS_RANGE2(h) ((h)->cfg.reg0.messb2 != 0)
 
 /**
- * @brief 写入8位数据
- * @param wbuf8 待写入的8位数据
+ * @brief 已注册的TDC句柄，TDC_INT中断按引脚查找对应的芯片
  */
-void write8(uint8_t wbuf8) {
-    uint8_t cnt;
-    uint8_t MSB8 = 0x80;
-    
-    SSN(0);
-    for (cnt = 8; cnt > 0; cnt--) {
-        if ((wbuf8 & MSB8) > 0)
-            send1();
-        else
-            send0();
-        MSB8 /= 2;
-    }
-    delay(1);  // 这里没有SPI关闭命令，在测试程序中代码关闭
-}
+static TDC_HandleTypeDef *g_tdc_handles[MAX_TDC_DEVICES] = {NULL};
 
 /**
- * @brief 写入32位数据
- * @param wbuf32 待写入的32位数据
+ * @brief 注册TDC设备
+ * @note  同一个TDC_INT引脚重复注册时替换原来的句柄
  */
-void write32(uint32_t wbuf32) {
-    uint8_t cnt;
-    uint32_t MSB32 = 0x80000000;
-    
-    SSN(0);
-    delay(1);
-    for (cnt = 32; cnt > 0; cnt--) {
-        if ((wbuf32 & MSB32) > 0)
-            send1();
-        else
-            send0();
-        MSB32 /= 2;
+static void TDC_Register_Device(TDC_HandleTypeDef *htdc) {
+    for (int i = 0; i < MAX_TDC_DEVICES; i++) {
+        if (g_tdc_handles[i] == NULL || g_tdc_handles[i]->int_pin == htdc->int_pin) {
+            g_tdc_handles[i] = htdc;
+            break;
+        }
     }
-    delay(1);
-    SSN(1);
 }
 
 /**
- * @brief 读取8位数据
- * @return 读取到的8位数据
+ * @brief TDC实例初始化
+ * @param htdc TDC句柄
+ * @param hspi 硬件SPI句柄，不使用硬件SPI时可以为NULL
+ * @param ssn_port SSN引脚端口
+ * @param ssn_pin SSN引脚号
+ * @note  配置恢复为测量范围1默认值，Tref取标称值 (晶振校准缓存无效)
  */
-uint8_t read8(void) {
-    uint8_t cnt;
-    uint8_t LSB8 = 0x80;
-    uint8_t rbuf8 = 0x00;
-    
-    SSN(0);
-    delay(3);
-    for (cnt = 8; cnt > 0; cnt--) {
-        //rbuf8 <<= 1;
-        SCK(1);
-        delay(3);
-
-        if (SO())
-            rbuf8 |= LSB8;
-        LSB8 /= 2;
-        delay(1);
-        SCK(0);
-        delay(10);
-    }
-    delay(3);
-    SSN(1);
-    return rbuf8;
+void TDC_Init_Instance(TDC_HandleTypeDef *htdc, SPI_HandleTypeDef *hspi,
+                       GPIO_TypeDef *ssn_port, uint16_t ssn_pin) {
+    static const TDC_ConfigTypeDef range1 = TDC_CONFIG_RANGE1_DEFAULT;
+
+    htdc->hspi = hspi;
+    htdc->ops = NULL;
+    htdc->ssn_port = ssn_port;
+    htdc->ssn_pin = ssn_pin;
+
+    htdc->cfg = range1;
+    htdc->hitin1 = range1.reg1.hitin1;
+    htdc->hitin2 = range1.reg1.hitin2;
+
+    // Tref以飞秒为单位保存：校准时测得 ANZ_PER_CALRES 个32.768kHz周期 = M 个Tref，
+    // 于是 Tref = T_cal / M，与晶振标称频率无关。
+    htdc->tref_fs = TDC_TREF_FS(range1.reg0.div_clkhs);
+    htdc->cal_valid = 0;
+    htdc->cal_tick = 0;
+    htdc->cal_interval = TDC_CAL_INTERVAL_MS;
+
+    htdc->busy = 0;
+    htdc->done = 0;
+    htdc->cal_run = 0;
+    htdc->result = 0;
+    htdc->start_cb = NULL;
+    htdc->cplt_cb = NULL;
+    htdc->cal_cb = NULL;
+    memset(&htdc->err, 0, sizeof(htdc->err));
+
+    htdc->pipe_run = 0;
+    htdc->pipe_left = 0;
+    htdc->pipe_shots = 0;
+    htdc->pipe_t_fire = 0;
 }
 
 /**
- * @brief 读取32位数据
- * @return 读取到的32位数据
+ * @brief 配置TDC的中断与复位引脚
+ * @param htdc TDC句柄
+ * @param int_port TDC_INT引脚端口，需配置为下降沿EXTI
+ * @param int_pin TDC_INT引脚号，每片芯片必须使用不同的EXTI线，
+ *        该线所属的EXTI中断服务函数中要调用 TDC_EXTI_IRQHandler()
+ * @param rtn_port RTN引脚端口
+ * @param rtn_pin RTN引脚号
  */
-uint32_t read32(void) {
-    uint8_t cnt;
-    uint32_t LSB32 = 0x80000000;
-    uint32_t rbuf32 = 0x00000000;
-    
-    SSN(0);
-    delay(1);
-    for (cnt = 32; cnt > 0; cnt--) {
-        //rbuf32 <<=1;
-        SCK(1);
-        delay(3);
-        if (SO())
-            rbuf32 |= LSB32;
-        LSB32 /= 2;
-        delay(1);
-        SCK(0);
-        delay(3);
-    }
-    delay(3);
-    SSN(1);
-    return rbuf32;
+void TDC_Config_Pins(TDC_HandleTypeDef *htdc, GPIO_TypeDef *int_port, uint16_t int_pin,
+                     GPIO_TypeDef *rtn_port, uint16_t rtn_pin) {
+    htdc->int_port = int_port;
+    htdc->int_pin = int_pin;
+    htdc->rtn_port = rtn_port;
+    htdc->rtn_pin = rtn_pin;
 }
 
 /**
  * @brief 复位TDC芯片
  */
-void reset(void) {
-    RTN(1);
-    delay(1);
-    RTN(0);
-    delay(5);
-    RTN(1);
-    delay(1);
+static void reset(TDC_HandleTypeDef *htdc) {
+    RTN(htdc, 1);
+    DWT_Delay_ns(TDC_T_RTN_LOW_NS);
+    RTN(htdc, 0);
+    DWT_Delay_ns(TDC_T_RTN_LOW_NS);
+    RTN(htdc, 1);
+    DWT_Delay_ns(TDC_T_RTN_RECOVER_NS);
 }
 
 /**
- * @brief 初始化TDC芯片
- * @note 配置TDC工作参数，包括测量范围、中断和时钟设置
+ * @brief 把EEPROM中的配置传送到配置寄存器，并确认与期望的写入字一致
+ * @param word 期望的写入字
+ * @return HAL_OK 一致；HAL_ERROR EEPROM有双错误或配置不同
+ * @note  Compare_EEPROM (0xC6) 确认传送后寄存器与EEPROM相同，
+ *        寄存器1的高8位是唯一可以读回的配置，用来确认EEPROM中保存的就是这一组配置
+ */
+static HAL_StatusTypeDef eep_transfer(TDC_HandleTypeDef *htdc, const uint32_t word[TDC_CFG_WORDS]) {
+    TDC_StatusTypeDef stat;
+
+    write8(htdc, 0xF0);         // EEPROM_to_Config
+    DWT_Delay_ns(TDC_T_EEP_XFER_NS);
+    write8(htdc, 0xC6);         // Compare_EEPROM，结果在状态寄存器的EEP_EQ
+    DWT_Delay_ns(TDC_T_EEP_XFER_NS);
+
+    stat = TDC_Get_Status(htdc);
+    if (!stat.bit.eep_eq || stat.bit.eep_ded)
+        return HAL_ERROR;
+    if (TDC_IO_Read8(htdc, 0xB5) != (uint8_t)(word[1] >> 16))
+        return HAL_ERROR;
+    return HAL_OK;
+}
+
+/**
+ * @brief 逐字写入全部配置寄存器并更新影子寄存器
  */
-void TDC_Init() {
-    reset();
+static void write_all(TDC_HandleTypeDef *htdc, const uint32_t word[TDC_CFG_WORDS]) {
+    uint8_t i;
 
-    write8(0x50);         // power on reset;
-    delay(1);
-    SSN(1);
+    for (i = 0; i < TDC_CFG_WORDS; i++) {
+        write32(htdc, word[i]);
+        htdc->shadow[i] = word[i];
+    }
+}
+
+/**
+ * @brief 上电复位并装载全部配置寄存器
+ * @note  TDC_EEPROM_BOOT 为1时先从EEPROM装载，不一致时再逐字写入
+ */
+static void load_config(TDC_HandleTypeDef *htdc) {
+    uint32_t word[TDC_CFG_WORDS];
+
+    write8(htdc, 0x50);         // power on reset;
     
     //----------------------------------------------------------------------------
     // 测量范围1，用stop1的第一个脉冲减去START的脉冲
     // 注意：测量范围1中，从START开始到最后一个STOP信号的时间间隔不能超过1.8us，否则溢出。
-    /**/
-    write32(0x80009420);  // 测量范围1，校准陶瓷晶振时间为8个32K周期，244.14us 设置4M上电后一直起振，自动校准，上升沿敏感
-    delay(1);
-    write32(0x81010100);  // 测量范围1，STOP1-START
+    // 默认配置见 TDC_CONFIG_RANGE1_DEFAULT，运行时由 TDC_Config_Apply() 修改
 
     //----------------------------------------------------------------------------
     // 测量范围1，用stop2的第一个脉冲减去START脉冲
     // 注意：测量范围1中，从START开始到最后一个STOP信号的时间间隔不能超过1.8us，否则溢出。
     /*
     SPI_WRITE32(0x80008420);  // 测量范围1，校准陶瓷晶振时间为8个32K周期，244.14us 设置4M上电后一直起振，自动校准，上升沿敏感
-    delay(1);
     write32(0x81094800);      // 测量范围1，STOP2-START
     */
 
@@ -211,128 +203,891 @@ void TDC_Init() {
     // 注意：测量范围1中，从START开始到最后一个STOP信号的时间间隔不能超过1.8us，否则溢出。
     /*
     write32(0x80008420);  // 测量范围1，校准陶瓷晶振时间为8个32K周期，244.14us 设置4M上电后一直起振，自动校准，上升沿敏感
-    delay(1);
     write32(0x81194900);  // 测量范围1，1stSOTPCH2-1stSTOPCH1
     */
+    // 两个通道都相对START测量、STOP2接参考延迟时，可以同时得到被测时间和漂移，见 tdc_ref.h
     
     //----------------------------------------------------------------------------
-    // 测量范围2，用STOP1的第一个脉冲减去START的第二个脉冲
+    // 测量范围2，用STOP1的第一个脉冲减去START的第二个脉冲 (见 TDC_CONFIG_RANGE2_DEFAULT)
     /*
     write32(0x80009410);
     
     write32(0x80008468);  // 测量范围2中：自动校准，晶振上电后一直起振。
     // spi_write32(0x80008428); // 测量范围2中：自动校准，晶振上电后一直起振。
-    delay(1);
     write32(0x81214200);  // 测量范围2，STOP1接收1个脉冲，定义计算方法，用STOP1的第一个脉冲减去START脉冲
     */
 
-    delay(1);
-    write32(0x82E00000);  // 开启所有中断源
-    delay(1);
-    write32(0x83080000);  // 溢出预划分器64us
-    delay(1);
-    write32(0x84200000);
-    delay(1);
-    write32(0x85080000);
-    delay(1);
-    write8(0x70);
-    delay(1);
+    // 上电复位后芯片内容未知，全部装载并更新影子寄存器
+    TDC_Config_Pack(&htdc->cfg, word);
+#if TDC_EEPROM_BOOT
+    if (eep_transfer(htdc, word) == HAL_OK) {
+        memcpy(htdc->shadow, word, sizeof(word));
+        write8(htdc, 0x70);
+        return;
+    }
+    htdc->err.eep_fallback++;
+#endif
+    write_all(htdc, word);
+    write8(htdc, 0x70);
+}
+
+/**
+ * @brief 初始化TDC芯片
+ * @param htdc 已经过 TDC_Init_Instance()、TDC_Config_Pins() 和 TDC_IO_Init() 的句柄
+ * @note 配置TDC工作参数，包括测量范围、中断和时钟设置
+ */
+void TDC_Init(TDC_HandleTypeDef *htdc) {
+    TDC_Register_Device(htdc);
+    reset(htdc);
+    load_config(htdc);
+
+    TDC_Cal_Invalidate(htdc);
+    TDC_Calibrate(htdc, TDC_CAL_TIMEOUT_US);  // 失败时按标称频率换算，首次测量前会再次尝试
 }
 
 /**
  * @brief 获取TDC状态寄存器
  * @return 状态寄存器值
  */
-uint32_t TDC_Get_Status_Reg()
+uint32_t TDC_Get_Status_Reg(TDC_HandleTypeDef *htdc)
 {
     uint32_t reg;
 
     // while(INTN) //判断中断置位否
     //     delay_us(1);
 
-    write8(0xb4);
-    delay(1);
-    reg = read32();
+    reg = TDC_IO_Read32(htdc, 0xB4);
 
     return reg;
 }
 
+/**
+ * @brief 读取并解码状态寄存器
+ * @return 状态寄存器各字段
+ */
+TDC_StatusTypeDef TDC_Get_Status(TDC_HandleTypeDef *htdc) {
+    TDC_StatusTypeDef stat;
+
+    stat.raw = TDC_IO_Read16(htdc, 0xB4);
+    return stat;
+}
+
 /**
  * @brief TDC测试函数
  * @return 测试寄存器值
  */
-uint32_t TDC_Test() {
+uint32_t TDC_Test(TDC_HandleTypeDef *htdc) {
     uint32_t test_reg;
 
-    SSN(0);
-    write32(0x81884200);  // INTN的脉冲和这个有关。
-    delay(1);
-    write8(0xb5);
-    delay(1);
-    test_reg = read8();
-    SCK(0);
-    SSN(1);
+    write32(htdc, 0x81884200);  // INTN的脉冲和这个有关。
+    test_reg = TDC_IO_Read8(htdc, 0xB5);
+    write32(htdc, htdc->shadow[1]); // 恢复寄存器1
 
     return test_reg;
 }
 
 /**
- * @brief 将定点数转换为浮点数
- * @param fixedPoint 32位定点数
- * @return 转换后的浮点数值
+ * @brief 将TDC测量值转换为纳秒
+ * @param val TDC测量原始值
+ * @return 转换后的时间，单位为纳秒
+ */
+float TDC_to_ns(TDC_HandleTypeDef *htdc, uint32_t val) {
+    return TDC_ps_to_ns(TDC_Raw_to_ps(htdc, val));
+}
+
+/**
+ * @brief 设置每个STOP通道接收的脉冲数
+ * @param stop1 STOP1脉冲数，0-4
+ * @param stop2 STOP2脉冲数，0-4
+ * @return HAL_OK 设置成功；HAL_ERROR 参数错误；HAL_BUSY 测量进行中
+ * @note  两者之和为1到 TDC_MAX_HITS。TDC_INT在收齐全部脉冲 (或超时) 后才产生，
+ *        每个START只需读一次，就能得到电缆开路端、接头、故障点等多处反射。
  */
-float fixed2float(uint32_t fixedPoint) {
-    int16_t integerPart = (fixedPoint >> 16) & 0xFFFF;  // 获取高16位整数部分
-    uint16_t fractionalPart = fixedPoint & 0xFFFF;      // 获取低16位小数部分
+HAL_StatusTypeDef TDC_Set_Hits(TDC_HandleTypeDef *htdc, uint8_t stop1, uint8_t stop2) {
+    TDC_ConfigTypeDef cfg = htdc->cfg;
 
-    float result = (float)integerPart + ((float)fractionalPart / 65536.0f);  // 将小数部分除以2^16转换为浮点数
+    if (stop1 > 4 || stop2 > 4 || stop1 + stop2 == 0 || stop1 + stop2 > TDC_MAX_HITS)
+        return HAL_ERROR;
+    if (IS_RANGE2(htdc))
+        return (stop1 == 1 && stop2 == 0) ? HAL_OK : HAL_ERROR;  // 测量范围2只支持STOP1单脉冲
+    if (htdc->busy)
+        return HAL_BUSY;
 
-    return result;
+    // ALU自动计算的第一个结果是第一个STOP减START，其余的在读出时逐个计算
+    cfg.reg1.hit2 = HIT_START;
+    cfg.reg1.hit1 = stop1 ? HIT_CH1(1) : HIT_CH2(1);
+    cfg.reg1.hitin1 = stop1;
+    cfg.reg1.hitin2 = stop2;
+    return TDC_Config_Apply(htdc, &cfg);
 }
 
 /**
- * @brief 将TDC测量值转换为纳秒
- * @param val TDC测量原始值
- * @return 转换后的时间，单位为纳秒
+ * @brief 一次读出中属于STOP1的结果个数
+ * @param hits 测量结果，按 STOP1各脉冲、STOP2各脉冲 的顺序排列
+ * @return STOP1实际收到的脉冲数，不超过设置值；也是STOP2第一个结果的位置
+ */
+uint8_t TDC_Hits_Stop1_Count(const TDC_HandleTypeDef *htdc, const TDC_HitsTypeDef *hits) {
+    uint8_t n1 = hits->status.bit.hits1;
+
+    if (n1 > htdc->cfg.reg1.hitin1)
+        n1 = htdc->cfg.reg1.hitin1;
+    if (n1 > hits->count)
+        n1 = hits->count;
+    return n1;
+}
+
+/**
+ * @brief 新配置写入芯片后更新驱动中的配置
+ * @note  参考时钟分频或晶振校准周期改变时，晶振校准缓存失效
+ */
+static void config_update(TDC_HandleTypeDef *htdc, const TDC_ConfigTypeDef *cfg) {
+    uint8_t recal;
+
+    recal = cfg->reg0.div_clkhs != htdc->cfg.reg0.div_clkhs ||
+            cfg->reg0.anz_per_calres != htdc->cfg.reg0.anz_per_calres;
+    htdc->cfg = *cfg;
+    if (!cfg->reg0.messb2) {
+        htdc->hitin1 = cfg->reg1.hitin1;  // 切回测量范围1时恢复
+        htdc->hitin2 = cfg->reg1.hitin2;
+    }
+    if (recal)
+        TDC_Cal_Invalidate(htdc);
+}
+
+/**
+ * @brief 写入新配置，只写与影子寄存器不同的字
+ * @param cfg 新配置
+ * @return HAL_OK 写入成功；HAL_BUSY 测量进行中
+ * @note  有改动时最后发送Init。参考时钟分频或晶振校准周期改变时，晶振校准缓存失效。
+ */
+HAL_StatusTypeDef TDC_Config_Apply(TDC_HandleTypeDef *htdc, const TDC_ConfigTypeDef *cfg) {
+    uint32_t word[TDC_CFG_WORDS];
+    uint8_t i, changed = 0;
+
+    if (htdc->busy)
+        return HAL_BUSY;
+
+    TDC_Config_Pack(cfg, word);
+    for (i = 0; i < TDC_CFG_WORDS; i++) {
+        if (word[i] != htdc->shadow[i]) {
+            write32(htdc, word[i]);
+            htdc->shadow[i] = word[i];
+            changed++;
+        }
+    }
+
+    config_update(htdc, cfg);
+
+    if (changed)
+        write8(htdc, 0x70);
+    return HAL_OK;
+}
+
+/**
+ * @brief 获取当前配置
+ */
+void TDC_Config_Get(TDC_HandleTypeDef *htdc, TDC_ConfigTypeDef *cfg) {
+    *cfg = htdc->cfg;
+}
+
+/**
+ * @brief 把当前配置写入GP22片内EEPROM
+ * @return HAL_OK 写入并校验成功；HAL_BUSY 测量进行中；HAL_ERROR 校验失败
+ * @note  Write_Config_To_EEPROM (0xC0) 写入的是配置寄存器的当前内容，即影子寄存器。
+ *        写入后用Compare_EEPROM (0xC6) 确认。EEPROM写入次数有限，只在配置确定后调用一次，
+ *        以后上电由 TDC_Init() 从EEPROM装载。
+ */
+HAL_StatusTypeDef TDC_EEPROM_Store(TDC_HandleTypeDef *htdc) {
+    TDC_StatusTypeDef stat;
+
+    if (htdc->busy)
+        return HAL_BUSY;
+
+    write8(htdc, 0xC0);         // Write_Config_To_EEPROM
+    HAL_Delay(TDC_EEPROM_WRITE_MS);
+    write8(htdc, 0xC6);         // Compare_EEPROM
+    DWT_Delay_ns(TDC_T_EEP_XFER_NS);
+
+    stat = TDC_Get_Status(htdc);
+    return (stat.bit.eep_eq && !stat.bit.eep_ded) ? HAL_OK : HAL_ERROR;
+}
+
+/**
+ * @brief 从EEPROM装载配置，用于切换到EEPROM中保存的测量模式
+ * @param cfg EEPROM中应当保存的配置
+ * @return HAL_OK 配置已生效；HAL_BUSY 测量进行中
+ * @note  只发送一个传送操作码，比逐字写入快。EEPROM中的配置与cfg不一致时改为逐字写入全部寄存器，
+ *        结果相同，并计入 eep_fallback。
+ */
+HAL_StatusTypeDef TDC_EEPROM_Load(TDC_HandleTypeDef *htdc, const TDC_ConfigTypeDef *cfg) {
+    uint32_t word[TDC_CFG_WORDS];
+
+    if (htdc->busy)
+        return HAL_BUSY;
+
+    TDC_Config_Pack(cfg, word);
+    if (eep_transfer(htdc, word) == HAL_OK) {
+        memcpy(htdc->shadow, word, sizeof(word));
+    } else {
+        htdc->err.eep_fallback++;
+        write_all(htdc, word);  // 传送后寄存器内容未知，不能只写差异
+    }
+    config_update(htdc, cfg);
+
+    write8(htdc, 0x70);
+    return HAL_OK;
+}
+
+/**
+ * @brief 按寄存器0计算标称Tref (fs)
+ */
+static uint32_t tref_nominal_fs(TDC_HandleTypeDef *htdc) {
+    return TDC_TREF_FS(htdc->cfg.reg0.div_clkhs);
+}
+
+/**
+ * @brief 切换测量范围
+ * @param range TDC_RANGE_1 或 TDC_RANGE_2
+ * @return HAL_OK 切换成功；HAL_ERROR 参数错误；HAL_BUSY 测量进行中
+ * @note  只改写寄存器0和寄存器1，不需要复位和重新初始化。
+ *        两个范围的Tref不同，切换后晶振校准缓存失效，下一次测量前重新校准。
+ */
+HAL_StatusTypeDef TDC_Set_Range(TDC_HandleTypeDef *htdc, TDC_RangeTypeDef range) {
+    static const TDC_ConfigTypeDef range1 = TDC_CONFIG_RANGE1_DEFAULT;
+    static const TDC_ConfigTypeDef range2 = TDC_CONFIG_RANGE2_DEFAULT;
+    TDC_ConfigTypeDef cfg = htdc->cfg;
+
+    if (range != TDC_RANGE_1 && range != TDC_RANGE_2)
+        return HAL_ERROR;
+
+    // 只替换寄存器0、1，其余寄存器保持用户的设置
+    if (range == TDC_RANGE_2) {
+        cfg.reg0 = range2.reg0;
+        cfg.reg1 = range2.reg1;
+    } else {
+        cfg.reg0 = range1.reg0;
+        cfg.reg1 = range1.reg1;
+        cfg.reg1.hit1 = htdc->hitin1 ? HIT_CH1(1) : HIT_CH2(1);
+        cfg.reg1.hitin1 = htdc->hitin1;
+        cfg.reg1.hitin2 = htdc->hitin2;
+    }
+    return TDC_Config_Apply(htdc, &cfg);
+}
+
+/**
+ * @brief 获取当前测量范围
+ */
+TDC_RangeTypeDef TDC_Get_Range(TDC_HandleTypeDef *htdc) {
+    return IS_RANGE2(htdc) ? TDC_RANGE_2 : TDC_RANGE_1;
+}
+
+/**
+ * @brief 根据校准结果更新Tref
+ * @param res 校准结果 RES_0，T_cal 以Tref为单位的16.16定点数
+ */
+static void cal_update(TDC_HandleTypeDef *htdc, uint32_t res) {
+    uint64_t t_cal_fs = (2ULL << htdc->cfg.reg0.anz_per_calres) * 30517578125ULL;  // 1/32768 s = 30517578125 fs
+    uint32_t nominal = tref_nominal_fs(htdc);
+    uint32_t tref;
+
+    if (res == 0)
+        return;
+    tref = (uint32_t)((t_cal_fs << 16) / res);
+
+    // 偏差过大说明校准被打断或者晶振没有起振，保留原来的值
+    if ((uint64_t)(tref > nominal ? tref - nominal : nominal - tref) * 1000000U > (uint64_t)nominal * TDC_CAL_TOL_PPM)
+        return;
+
+    htdc->tref_fs = tref;
+    htdc->cal_tick = HAL_GetTick();
+    htdc->cal_valid = 1;
+}
+
+/**
+ * @brief 启动一次晶振校准，立即返回
+ * @return HAL_OK 已启动；HAL_BUSY 测量进行中
+ * @note  结果在TDC_INT中断里读出并缓存，完成后调用校准完成回调。
+ *        校准期间到达的START被忽略。
+ */
+HAL_StatusTypeDef TDC_Cal_Start_IT(TDC_HandleTypeDef *htdc) {
+    if (htdc->busy)
+        return HAL_BUSY;
+
+    htdc->cal_run = 1;
+    htdc->busy = 1;
+    write8(htdc, 0x70);                                  // Init，INTN回到高电平
+    __HAL_GPIO_EXTI_CLEAR_IT(htdc->int_pin);
+    write8(htdc, 0x03);                                  // Start_Cal_Resonator
+    return HAL_OK;
+}
+
+/**
+ * @brief 进行一次晶振校准 (阻塞方式)
+ * @param timeout_us 超时时间，单位微秒
+ * @return HAL_OK 校准成功；HAL_BUSY 测量进行中；HAL_TIMEOUT 超时；HAL_ERROR 校准结果超出允许范围
+ */
+HAL_StatusTypeDef TDC_Calibrate(TDC_HandleTypeDef *htdc, uint32_t timeout_us) {
+    DWT_DeadlineTypeDef dl;
+
+    DWT_Deadline_us(&dl, timeout_us);
+    if (TDC_Cal_Start_IT(htdc) != HAL_OK)
+        return HAL_BUSY;
+
+    while (htdc->cal_run) {
+        if (DWT_Expired(&dl)) {
+            TDC_Measure_Abort(htdc);
+            return HAL_TIMEOUT;
+        }
+    }
+
+    return htdc->cal_valid ? HAL_OK : HAL_ERROR;
+}
+
+/**
+ * @brief 查询是否需要重新校准晶振
+ * @return 1表示缓存无效或已过期
+ */
+uint8_t TDC_Cal_Due(TDC_HandleTypeDef *htdc) {
+    if (!htdc->cal_valid)
+        return 1;
+    return htdc->cal_interval != 0 && HAL_GetTick() - htdc->cal_tick >= htdc->cal_interval;
+}
+
+/**
+ * @brief 使晶振校准缓存失效，下一次测量前重新校准
+ * @note  温度变化较大时调用
+ */
+void TDC_Cal_Invalidate(TDC_HandleTypeDef *htdc) {
+    htdc->cal_valid = 0;
+    htdc->tref_fs = tref_nominal_fs(htdc);
+}
+
+/**
+ * @brief 设置晶振校准的刷新周期
+ * @param interval_ms 刷新周期，单位毫秒，0表示不自动刷新
+ */
+void TDC_Cal_Set_Interval(TDC_HandleTypeDef *htdc, uint32_t interval_ms) {
+    htdc->cal_interval = interval_ms;
+}
+
+/**
+ * @brief 注册晶振校准完成回调
+ * @param cal_cb 校准结果读出后在EXTI中断中调用，可以为NULL
+ */
+void TDC_Register_Cal_Callback(TDC_HandleTypeDef *htdc, TDC_CalCallbackTypeDef cal_cb) {
+    htdc->cal_cb = cal_cb;
+}
+
+/**
+ * @brief 获取当前使用的Tref
+ * @return 参考时钟周期，单位飞秒
+ */
+uint32_t TDC_Get_Tref_fs(TDC_HandleTypeDef *htdc) {
+    return htdc->tref_fs;
+}
+
+/**
+ * @brief 等待ALU算出第n个结果
+ * @param n 目标结果个数
+ * @param stat 返回最后读到的状态寄存器
+ * @return 1表示已算出，0表示超时
  */
-float TDC_to_ns(uint32_t val) {
-    float val_f = fixed2float(val);
-    return val_f / Fe9;
+static uint8_t alu_wait(TDC_HandleTypeDef *htdc, uint8_t n, uint16_t *stat) {
+    uint32_t t0 = DWT_Cycles();
+    uint32_t limit = DWT_ns_to_cycles(TDC_T_ALU_NS);
+
+    do {
+        *stat = TDC_IO_Read16(htdc, 0xB4);
+        if (STAT_PTR(*stat) >= n)
+            return 1;
+    } while (DWT_Cycles() - t0 < limit);
+    return 0;
+}
+
+/**
+ * @brief 读出一次START的全部结果
+ * @note  ALU每次只算一个结果。依次改写寄存器1的HIT1让ALU算出其余结果，
+ *        然后连续读出结果寄存器，最后恢复寄存器1，供下一次测量的自动计算使用。
+ */
+static void read_hits(TDC_HandleTypeDef *htdc, TDC_HitsTypeDef *hits) {
+    uint8_t ops[TDC_MAX_HITS];
+    uint8_t n = 0, done, i;
+    uint16_t stat = TDC_IO_Read16(htdc, 0xB4);
+
+    if (IS_RANGE2(htdc)) {
+        hits->raw[0] = TDC_IO_Read32(htdc, 0xB0);  // READ RES_0
+        hits->count = STAT_PTR(stat) ? 1 : 0;
+        hits->status.raw = stat;
+        return;
+    }
+
+    for (i = 1; i <= htdc->cfg.reg1.hitin1 && i <= STAT_HIT1(stat) && n < TDC_MAX_HITS; i++)
+        ops[n++] = HIT_CH1(i);
+    for (i = 1; i <= htdc->cfg.reg1.hitin2 && i <= STAT_HIT2(stat) && n < TDC_MAX_HITS; i++)
+        ops[n++] = HIT_CH2(i);
+
+    // 收齐脉冲时第一个结果已自动算出；超时则一个也没有算
+    done = STAT_PTR(stat);
+    if (done > n)
+        done = n;
+    for (i = done; i < n; i++) {
+        write32(htdc, (htdc->shadow[1] & ~(REG1_HIT2(0xF) | REG1_HIT1(0xF))) | REG1_HIT2(HIT_START) | REG1_HIT1(ops[i]));
+        if (!alu_wait(htdc, i + 1, &stat))
+            break;
+    }
+    n = i;
+
+    for (i = 0; i < n; i++)
+        hits->raw[i] = TDC_IO_Read32(htdc, 0xB0 + i);  // READ RES_i
+    // 写寄存器1会让ALU再算一次，结果写到下一个结果寄存器，n为4时会覆盖RES_0，必须在读完之后
+    if (n != done)
+        write32(htdc, htdc->shadow[1]);
+    hits->count = n;
+    hits->status.raw = stat;
+}
+
+/**
+ * @brief 注册异步测量回调
+ * @param start_cb START脉冲发出后调用，可以为NULL
+ * @param cplt_cb 测量结果读出后在EXTI中断中调用，可以为NULL
+ */
+void TDC_Register_Callbacks(TDC_HandleTypeDef *htdc, TDC_StartCallbackTypeDef start_cb, TDC_CpltCallbackTypeDef cplt_cb) {
+    htdc->start_cb = start_cb;
+    htdc->cplt_cb = cplt_cb;
+}
+
+/**
+ * @brief 发送Init操作码，使TDC准备接收下一个START，但不发出START
+ * @return HAL_OK 已准备好；HAL_BUSY 上一次测量尚未完成
+ * @note 用于由硬件 (TIM4触发的TIM1脉冲) 发出START的场合
+ */
+HAL_StatusTypeDef TDC_Measure_Arm_IT(TDC_HandleTypeDef *htdc) {
+    if (htdc->busy)
+        return HAL_BUSY;
+
+    htdc->done = 0;
+    write8(htdc, 0x70);                                  // Init，INTN回到高电平
+
+    htdc->busy = 1;
+    __HAL_GPIO_EXTI_CLEAR_IT(htdc->int_pin);             // 丢弃之前残留的下降沿
+    return HAL_OK;
+}
+
+/**
+ * @brief 启动一次异步测量，立即返回
+ * @return HAL_OK 已发出START；HAL_BUSY 上一次测量尚未完成；HAL_ERROR START脉冲发生器忙
+ * @note 结果在TDC_INT下降沿中断里读出，通过完成回调或 TDC_Get_Result() 获取
+ */
+HAL_StatusTypeDef TDC_Measure_Start_IT(TDC_HandleTypeDef *htdc) {
+    if (TDC_Measure_Arm_IT(htdc) != HAL_OK)
+        return HAL_BUSY;
+
+    if (TDC_Pulse_Fire(1) != HAL_OK) {                   // TIM1_CH3输出固定宽度的START脉冲
+        htdc->busy = 0;
+        return HAL_ERROR;
+    }
+
+    if (htdc->start_cb != NULL)
+        htdc->start_cb(htdc);
+
+    return HAL_OK;
+}
+
+/**
+ * @brief 多片TDC同时测量，立即返回
+ * @param htdc 句柄数组
+ * @param n 句柄个数
+ * @return HAL_OK 已发出START；HAL_BUSY 某一片的上一次测量尚未完成；HAL_ERROR START脉冲发生器忙
+ * @note  各片共用同一个START脉冲：先逐片发送Init，再发出一个START，
+ *        各片分别在自己的TDC_INT中断里读出，结果与单片测量相同。
+ *        任何一片不能准备时，已经准备好的也一起放弃。
+ */
+HAL_StatusTypeDef TDC_Measure_Start_Multi_IT(TDC_HandleTypeDef *const htdc[], uint8_t n) {
+    uint8_t i, j;
+
+    for (i = 0; i < n; i++) {
+        if (TDC_Measure_Arm_IT(htdc[i]) != HAL_OK) {
+            for (j = 0; j < i; j++)
+                htdc[j]->busy = 0;
+            return HAL_BUSY;
+        }
+    }
+
+    if (TDC_Pulse_Fire(1) != HAL_OK) {
+        for (i = 0; i < n; i++)
+            htdc[i]->busy = 0;
+        return HAL_ERROR;
+    }
+
+    for (i = 0; i < n; i++) {
+        if (htdc[i]->start_cb != NULL)
+            htdc[i]->start_cb(htdc[i]);
+    }
+
+    return HAL_OK;
+}
+
+/**
+ * @brief 放弃正在进行的异步测量
+ */
+void TDC_Measure_Abort(TDC_HandleTypeDef *htdc) {
+    htdc->pipe_run = 0;
+    htdc->cal_run = 0;
+    htdc->busy = 0;
+}
+
+/**
+ * @brief 流水线中发送Init并立即发出下一个START
+ * @return HAL_OK 已发出；HAL_ERROR START脉冲发生器忙
+ * @note  与 TDC_Measure_Start_IT() 一样在START发出后调用start_cb
+ */
+static HAL_StatusTypeDef pipe_fire(TDC_HandleTypeDef *htdc) {
+    write8(htdc, 0x70);                                  // Init，INTN回到高电平
+    htdc->busy = 1;
+    htdc->pipe_t_fire = DWT_Cycles();
+    __HAL_GPIO_EXTI_CLEAR_IT(htdc->int_pin);
+
+    if (TDC_Pulse_Fire(1) != HAL_OK) {
+        htdc->busy = 0;
+        htdc->pipe_run = 0;
+        return HAL_ERROR;
+    }
+
+    if (htdc->start_cb != NULL)
+        htdc->start_cb(htdc);
+    return HAL_OK;
 }
 
 /**
- * @brief 进行一次TDC测量
+ * @brief 流水线中一次测量的结果已读入，准备下一次测量
+ * @param t_int 进入TDC_INT中断时的DWT周期数
+ * @note  结果寄存器和状态寄存器在Init后就不再有效，所以必须先读出再Init，
+ *        读出、Init、START是串行的 (latch_ns)，与转换重叠的只有此后的完成回调。
+ */
+static void pipe_next(TDC_HandleTypeDef *htdc, uint32_t t_int) {
+    htdc->pipe_period_sum += t_int - htdc->pipe_t_int;
+    htdc->pipe_t_int = t_int;
+    htdc->pipe_shots++;
+
+    if (htdc->pipe_left != 0 && --htdc->pipe_left == 0) {
+        htdc->pipe_run = 0;
+        return;
+    }
+
+    // 晶振校准到期时插入一次校准，完成后在校准分支里继续
+    if (TDC_Cal_Due(htdc) && TDC_Cal_Start_IT(htdc) == HAL_OK) {
+        htdc->pipe_t_fire = DWT_Cycles();
+        return;
+    }
+
+    if (pipe_fire(htdc) == HAL_OK)
+        htdc->pipe_latch_sum += DWT_Cycles() - t_int;
+}
+
+/**
+ * @brief 启动流水线测量，立即返回
+ * @param htdc TDC句柄
+ * @param count 测量次数，0表示一直进行到 TDC_Pipeline_Stop()
+ * @return HAL_OK 已启动；HAL_BUSY 测量进行中；HAL_ERROR START脉冲发生器忙
+ * @note  每次TDC_INT中断读出结果后立即发送Init并发出下一个START，然后才调用完成回调，
+ *        只有回调里的处理 (换算、统计等) 与下一次转换重叠；结果读出本身不重叠，
+ *        每次测量的周期至少是转换时间加上 latch_ns。
+ *        读出与转换真正重叠需要EN_FAST_INIT，但那时下一次测量会覆盖ALU计算其余脉冲所需的数据，
+ *        只适用于单脉冲结果，见 tdc_dma.h。结果只通过完成回调逐个交付，
+ *        TDC_Get_Hits() 只能取到最近一次的结果。
+ *        START由软件触发，不能与TIM4连续采集同时使用。
+ *        下一次START由TDC_INT中断发出，TDC_INT丢失时流水线会停住，主循环应周期调用
+ *        TDC_Pipeline_Poll()。
+ */
+HAL_StatusTypeDef TDC_Pipeline_Start_IT(TDC_HandleTypeDef *htdc, uint32_t count) {
+    HAL_StatusTypeDef ret;
+
+    if (htdc->busy)
+        return HAL_BUSY;
+
+    htdc->pipe_left = count;
+    htdc->pipe_shots = 0;
+    htdc->pipe_period_sum = 0;
+    htdc->pipe_latch_sum = 0;
+    htdc->pipe_t_int = DWT_Cycles();
+    htdc->pipe_t_fire = htdc->pipe_t_int;
+    htdc->pipe_run = 1;
+
+    ret = TDC_Measure_Start_IT(htdc);
+    if (ret != HAL_OK)
+        htdc->pipe_run = 0;
+    return ret;
+}
+
+/**
+ * @brief 停止流水线测量
+ * @note  已经发出的那一次测量照常完成并调用完成回调
+ */
+void TDC_Pipeline_Stop(TDC_HandleTypeDef *htdc) {
+    htdc->pipe_run = 0;
+}
+
+/**
+ * @brief 检查流水线是否因TDC_INT丢失而停住，停住时恢复并继续
+ * @return 1表示进行了恢复
+ * @note  在主循环中周期调用。一次测量或插入的晶振校准超过 TDC_PIPE_STALL_US 仍未完成时，
+ *        与 TDC_Measure() 超时一样计入no_int并执行 TDC_Recover()，然后发出下一个START。
+ *        判断和放弃在关中断下进行，不会与刚好到来的TDC_INT中断冲突。
+ */
+uint8_t TDC_Pipeline_Poll(TDC_HandleTypeDef *htdc) {
+    uint32_t primask;
+    uint8_t stall;
+
+    if (!htdc->pipe_run || !htdc->busy)
+        return 0;
+
+    primask = __get_PRIMASK();
+    __disable_irq();
+    stall = htdc->pipe_run && htdc->busy &&
+            DWT_Cycles() - htdc->pipe_t_fire > DWT_ns_to_cycles(TDC_PIPE_STALL_US * 1000U);
+    if (stall) {
+        htdc->cal_run = 0;
+        htdc->busy = 0;  // 此后到来的TDC_INT被忽略，流水线仍保持进行中
+    }
+    __set_PRIMASK(primask);
+
+    if (!stall)
+        return 0;
+
+    htdc->err.no_int++;
+    TDC_Recover(htdc);
+    if (htdc->pipe_run)
+        pipe_fire(htdc);  // 失败时清除pipe_run
+    return 1;
+}
+
+/**
+ * @brief 查询流水线测量是否进行中
+ */
+uint8_t TDC_Pipeline_Is_Running(TDC_HandleTypeDef *htdc) {
+    return htdc->pipe_run;
+}
+
+/**
+ * @brief 获取流水线测量的吞吐量
+ * @param htdc TDC句柄
+ * @param stats 从 TDC_Pipeline_Start_IT() 开始的平均值
+ */
+void TDC_Pipeline_Get_Stats(TDC_HandleTypeDef *htdc, TDC_PipeStatsTypeDef *stats) {
+    uint32_t primask, shots;
+    uint64_t period, latch;
+
+    primask = __get_PRIMASK();
+    __disable_irq();
+    shots = htdc->pipe_shots;
+    period = htdc->pipe_period_sum;
+    latch = htdc->pipe_latch_sum;
+    __set_PRIMASK(primask);
+
+    stats->shots = shots;
+    if (shots == 0 || period == 0) {
+        stats->rate_hz = 0;
+        stats->period_ns = 0;
+        stats->latch_ns = 0;
+        return;
+    }
+    stats->rate_hz = (uint32_t)((uint64_t)shots * SystemCoreClock / period);
+    stats->period_ns = DWT_cycles_to_ns((uint32_t)(period / shots));
+    stats->latch_ns = DWT_cycles_to_ns((uint32_t)(latch / shots));
+}
+
+/**
+ * @brief 查询是否有测量正在进行
+ * @return 1表示测量进行中
+ */
+uint8_t TDC_Is_Busy(TDC_HandleTypeDef *htdc) {
+    return htdc->busy;
+}
+
+/**
+ * @brief 取出最近一次完成的测量结果
  * @param result 存储测量结果的指针
- * @param timeout 超时时间，单位毫秒
+ * @return 1表示有新结果，0表示没有
+ */
+uint8_t TDC_Get_Result(TDC_HandleTypeDef *htdc, uint32_t *result) {
+    if (!htdc->done)
+        return 0;
+
+    *result = htdc->result;
+    htdc->done = 0;
+    return 1;
+}
+
+/**
+ * @brief 取出最近一次完成的全部测量结果
+ * @param hits 存储测量结果的指针
+ * @return 1表示有新结果，0表示没有
+ */
+uint8_t TDC_Get_Hits(TDC_HandleTypeDef *htdc, TDC_HitsTypeDef *hits) {
+    if (!htdc->done)
+        return 0;
+
+    *hits = htdc->hits;
+    htdc->done = 0;
+    return 1;
+}
+
+/**
+ * @brief TDC_INT下降沿中断处理，读出结果并调用完成回调
+ */
+void TDC_INT_IRQHandler(TDC_HandleTypeDef *htdc) {
+    uint32_t t_int = DWT_Cycles();
+
+    if (!htdc->busy)
+        return;  // 没有发起测量时的下降沿 (如上电复位)，忽略
+
+    if (htdc->cal_run) {
+        cal_update(htdc, TDC_IO_Read32(htdc, 0xB0));
+        htdc->cal_run = 0;
+        htdc->busy = 0;
+        if (htdc->pipe_run)
+            pipe_fire(htdc);
+        if (htdc->cal_cb != NULL)
+            htdc->cal_cb(htdc);
+        return;
+    }
+
+    read_hits(htdc, &htdc->hits);
+    htdc->result = htdc->hits.count ? htdc->hits.raw[0] : 0;
+
+    // STOP缺失只需要Init，而下一次测量开始时总会发送Init，这里只计数
+    if (htdc->hits.status.bit.timeout_tdc)
+        htdc->err.timeout_tdc++;
+    if (htdc->hits.status.bit.timeout_precnt)
+        htdc->err.timeout_precnt++;
+    htdc->busy = 0;
+    htdc->done = 1;
+
+    if (htdc->pipe_run)
+        pipe_next(htdc, t_int);
+
+    if (htdc->cplt_cb != NULL)
+        htdc->cplt_cb(htdc, &htdc->hits);
+}
+
+/**
+ * @brief 所有TDC共用的EXTI中断分发
+ * @note  逐个检查已注册芯片TDC_INT引脚的挂起标志，清除后读出结果，
+ *        不依赖某一个固定的引脚。各片的TDC_INT接在哪些EXTI线上，
+ *        就要在对应的每个EXTIx_IRQHandler中调用本函数。
+ */
+void TDC_EXTI_IRQHandler(void) {
+    for (int i = 0; i < MAX_TDC_DEVICES; i++) {
+        TDC_HandleTypeDef *htdc = g_tdc_handles[i];
+
+        if (htdc != NULL && __HAL_GPIO_EXTI_GET_IT(htdc->int_pin) != 0x00U) {
+            __HAL_GPIO_EXTI_CLEAR_IT(htdc->int_pin);
+            TDC_INT_IRQHandler(htdc);
+        }
+    }
+}
+
+/**
+ * @brief EXTI中断回调
+ * @param GPIO_Pin 触发中断的引脚
+ * @note  按TDC_INT引脚查找已注册的芯片，供直接使用 HAL_GPIO_EXTI_IRQHandler() 的场合
+ */
+void HAL_GPIO_EXTI_Callback(uint16_t GPIO_Pin) {
+    for (int i = 0; i < MAX_TDC_DEVICES; i++) {
+        if (g_tdc_handles[i] != NULL && g_tdc_handles[i]->int_pin == GPIO_Pin) {
+            TDC_INT_IRQHandler(g_tdc_handles[i]);
+            break;
+        }
+    }
+}
+
+/**
+ * @brief 进行一次TDC测量 (阻塞方式)
+ * @param result 存储测量结果的指针
+ * @param timeout_us 超时时间，单位微秒，从发出START开始计算，接近预期的测量时间即可
  * @return 0表示测量成功，1表示测量超时
+ * @note 基于 TDC_Measure_Start_IT()，等待期间只检查完成标志。
+ *       需要的晶振校准不计入超时，按 TDC_CAL_TIMEOUT_US 单独等待
  */
-uint8_t TDC_Measure(uint32_t *result, uint32_t timeout) {
-    uint32_t t = HAL_GetTick();
-
-    write8(0x70);
-    delay(1);
-    SSN(1);
-    //HAL_GPIO_WritePin(PULSE_GPIO_Port, PULSE_Pin, GPIO_PIN_RESET);
-    PULSE_GPIO_Port->BSRR = (uint32_t)PULSE_Pin << 16U;  // 清除PULSE引脚
-    for (uint8_t i = 0; i < 1; i++) {}                   // 短延时
-    PULSE_GPIO_Port->BSRR = PULSE_Pin;                   // 设置PULSE引脚
-    //HAL_GPIO_WritePin(PULSE_GPIO_Port, PULSE_Pin, GPIO_PIN_SET);
-
-    while (INT()) {
-        delay(1);
-        if (HAL_GetTick() - t > timeout) {
+uint8_t TDC_Measure(TDC_HandleTypeDef *htdc, uint32_t *result, uint32_t timeout_us) {
+    DWT_DeadlineTypeDef dl;
+
+    if (TDC_Cal_Due(htdc))
+        TDC_Calibrate(htdc, TDC_CAL_TIMEOUT_US);   // 缓存过期才校准，平时不占用测量时间
+    DWT_Deadline_us(&dl, timeout_us);
+    if (TDC_Measure_Start_IT(htdc) != HAL_OK)
+        return 1;
+
+    while (!TDC_Get_Result(htdc, result)) {
+        if (DWT_Expired(&dl)) {
+            TDC_Measure_Abort(htdc);
+            htdc->err.no_int++;
+            TDC_Recover(htdc);
             return 1;  // 测量超时
         }
     }
 
-    delay(1);
-    write8(0xB0);      // READ REG0
-    delay(1);
-    *result = read32();
+    return 0;          // 测量成功
+}
+
+/**
+ * @brief 进行一次多脉冲TDC测量 (阻塞方式)
+ * @param hits 存储全部测量结果的指针
+ * @param timeout_us 超时时间，单位微秒
+ * @return 0表示测量成功，1表示测量超时
+ */
+uint8_t TDC_Measure_Hits(TDC_HandleTypeDef *htdc, TDC_HitsTypeDef *hits, uint32_t timeout_us) {
+    DWT_DeadlineTypeDef dl;
+
+    if (TDC_Cal_Due(htdc))
+        TDC_Calibrate(htdc, TDC_CAL_TIMEOUT_US);
+    DWT_Deadline_us(&dl, timeout_us);
+    if (TDC_Measure_Start_IT(htdc) != HAL_OK)
+        return 1;
+
+    while (!TDC_Get_Hits(htdc, hits)) {
+        if (DWT_Expired(&dl)) {
+            TDC_Measure_Abort(htdc);
+            htdc->err.no_int++;
+            TDC_Recover(htdc);
+            return 1;  // 测量超时
+        }
+    }
 
     return 0;          // 测量成功
 }
 
+/**
+ * @brief 使没有产生TDC_INT的TDC恢复工作，自动选择代价最小的方式
+ * @return 实际采用的恢复方式
+ * @note  先读回寄存器1的高8位：与写入值一致说明芯片配置还在，只需要Init；
+ *        否则 (掉电、复位、总线异常) 复位并重新写入全部配置，晶振校准同时失效。
+ *        不使用HAL_GetTick，可以在中断中调用。
+ */
+TDC_RecoverTypeDef TDC_Recover(TDC_HandleTypeDef *htdc) {
+    if (htdc->busy)
+        return TDC_RECOVER_NONE;
+
+    if (TDC_IO_Read8(htdc, 0xB5) == (uint8_t)(htdc->shadow[1] >> 16)) {
+        write8(htdc, 0x70);
+        htdc->err.init++;
+        return TDC_RECOVER_INIT;
+    }
+
+    reset(htdc);
+    load_config(htdc);
+    TDC_Cal_Invalidate(htdc);
+    htdc->err.reinit++;
+    return TDC_RECOVER_REINIT;
+}
+
+/**
+ * @brief 获取错误与恢复计数
+ */
+void TDC_Get_Error_Stats(TDC_HandleTypeDef *htdc, TDC_ErrorStatsTypeDef *stats) {
+    *stats = htdc->err;
+}
+
 /**
  * @brief 转换TDC值为时间 (未使用)
  * @param val TDC测量原始值
@@ -0,0 +1,365 @@
+/**
+ * @file    tdc_acq.c
+ * @brief   TIM4定时触发的TDC连续采集实现
+ */
+#include "tdc_acq.h"
+#include "tdc.h"
+#include "tim.h"
+#include "dwt.h"
+#include "tdc_pulse.h"
+#include "tdc_conv.h"
+#include "tdc_dma.h"
+
+static TDC_HandleTypeDef *g_htdc = NULL;   // 进行采集的TDC
+static TDC_RingTypeDef g_ring;             // 测量结果环形缓冲区
+static TDC_AcqStatsTypeDef g_stats;        // 采集计数 (overrun 取自环形缓冲区)
+static volatile uint8_t g_running = 0;     // 连续采集进行中
+static volatile uint32_t g_t_start = 0;    // 当前测量START时刻
+static volatile uint8_t g_armed = 0;       // 已发送Init，等待下一个TIM4边沿发出START
+static volatile uint32_t g_t_armed = 0;    // 发送Init的时刻
+static uint32_t g_seq = 0;                 // 下一条记录的序号
+static TDC_StatsTypeDef g_time_stats[TDC_CH_COUNT];  // 各通道时间的统计
+static TDC_DistTypeDef g_dist[TDC_CH_COUNT];          // 各通道时间的分布
+static TDC_RefTypeDef g_ref;               // STOP2参考通道补偿
+static uint8_t g_ref_on = 0;               // 参考通道补偿已开启
+static uint8_t g_dual_on = 0;              // 双通道测量已开启
+
+/**
+ * @brief 计算TIM4的计数时钟
+ * @note  APB1分频不为1时，定时器时钟是PCLK1的2倍
+ */
+static uint32_t TIM4_Clock(void) {
+    uint32_t clk = HAL_RCC_GetPCLK1Freq();
+
+    if ((RCC->D2CFGR & RCC_D2CFGR_D2PPRE1) != RCC_APB1_DIV1)
+        clk *= 2;
+    return clk;
+}
+
+/**
+ * @brief 让TDC准备接收下一个由TIM4触发的START
+ */
+static void acq_arm(TDC_HandleTypeDef *htdc) {
+    if (TDC_Measure_Arm_IT(htdc) == HAL_OK) {
+        g_t_armed = DWT_Cycles();
+        g_armed = 1;
+    }
+}
+
+/**
+ * @brief 写入一条记录，有结果时计入所属通道的统计
+ * @param valid 记录中的ps有效，写入 TDC_RecordTypeDef.valid
+ */
+static void acq_push(TDC_RecordTypeDef *rec, uint8_t valid) {
+    rec->valid = valid;
+    TDC_Ring_Push(&g_ring, rec);
+    if (valid) {
+        TDC_Stats_Add(&g_time_stats[rec->ch], rec->ps);
+        TDC_Dist_Add(&g_dist[rec->ch], rec->ps);
+    }
+}
+
+/**
+ * @brief 双通道模式：同一次读出中的STOP1、STOP2结果分别写入记录
+ * @note  两个通道都没有结果时仍写入一条STOP1记录，消费者可以看到这次START
+ */
+static void acq_dual(TDC_HandleTypeDef *htdc, TDC_RecordTypeDef *rec) {
+    TDC_ScaleTypeDef scale;
+    uint8_t n1 = TDC_Hits_Stop1_Count(htdc, &rec->hits);
+
+    TDC_Get_Scale(htdc, &scale);
+    if (n1 != 0 || rec->hits.count == 0) {
+        rec->ch = TDC_CH_STOP1;
+        rec->ps = (n1 != 0) ? TDC_Fixed_to_ps(rec->hits.raw[0], &scale) : 0;
+        acq_push(rec, n1 != 0);
+    }
+    if (rec->hits.count > n1) {
+        rec->ch = TDC_CH_STOP2;
+        rec->ps = TDC_Fixed_to_ps(rec->hits.raw[n1], &scale);
+        acq_push(rec, 1);
+    }
+}
+
+/**
+ * @brief 测量完成回调，运行在EXTI中断中
+ */
+static void acq_cplt(TDC_HandleTypeDef *htdc, const TDC_HitsTypeDef *hits) {
+    TDC_RecordTypeDef rec;
+
+    rec.seq = g_seq++;
+    rec.timestamp = g_t_start;
+    rec.ch = TDC_CH_STOP1;
+    rec.ref = g_ref_on;
+    rec.hits = *hits;
+    rec.ps = 0;
+    g_stats.completed++;
+    if (g_dual_on) {
+        acq_dual(htdc, &rec);
+    } else {
+        uint8_t valid = hits->count != 0;
+
+        // 参考通道模式下STOP1缺失或还没有漂移估计时，记录仍写入但不计入统计
+        if (g_ref_on)
+            valid = TDC_Ref_Correct(&g_ref, htdc, hits, &rec.ps);
+        else if (valid)
+            rec.ps = TDC_Raw_to_ps(htdc, hits->raw[0]);
+        acq_push(&rec, valid);
+    }
+
+    // 晶振校准缓存到期时插入一次校准，完成后由校准回调重新准备
+    if (TDC_Cal_Due(htdc) && TDC_Cal_Start_IT(htdc) == HAL_OK)
+        return;
+
+    acq_arm(htdc);  // 下一个TIM4边沿由硬件直接发出START
+}
+
+/**
+ * @brief 设置重复频率
+ */
+HAL_StatusTypeDef TDC_Acq_Set_Rate(uint32_t rate_hz) {
+    uint32_t ticks, psc, arr;
+
+    if (rate_hz == 0)
+        return HAL_ERROR;
+
+    ticks = TIM4_Clock() / rate_hz;
+    if (ticks < 2)
+        return HAL_ERROR;
+
+    psc = (ticks - 1) / 65536;
+    if (psc > 0xFFFF)
+        return HAL_ERROR;
+    arr = ticks / (psc + 1) - 1;
+
+    __HAL_TIM_SET_PRESCALER(&htim4, psc);
+    __HAL_TIM_SET_AUTORELOAD(&htim4, arr);
+    return HAL_OK;
+}
+
+/**
+ * @brief 开始连续采集
+ */
+HAL_StatusTypeDef TDC_Acq_Start(TDC_HandleTypeDef *htdc, uint32_t rate_hz) {
+    if (TDC_DMA_Is_Running())
+        return HAL_BUSY;  // TIM4和START触发正由DMA读出使用
+    if (TDC_Acq_Set_Rate(rate_hz) != HAL_OK)
+        return HAL_ERROR;
+
+    TDC_Acq_Stop();
+    g_htdc = htdc;
+    TDC_Ring_Reset(&g_ring);
+    g_stats.triggers = 0;
+    g_stats.missed = 0;
+    g_stats.completed = 0;
+    g_stats.recovered = 0;
+    g_seq = 0;
+    for (uint8_t ch = 0; ch < TDC_CH_COUNT; ch++) {
+        TDC_Stats_Init(&g_time_stats[ch], TDC_STATS_WINDOW);
+        TDC_Dist_Init(&g_dist[ch], 0, TDC_HIST_BIN_PS, 1);
+    }
+    TDC_Ref_Reset(&g_ref);
+
+    // 先装载TIM4的预分频值，UG产生的TRGO此时还不会触发START
+    __HAL_TIM_SET_COUNTER(&htim4, 0);
+    htim4.Instance->EGR = TIM_EGR_UG;
+    __HAL_TIM_CLEAR_FLAG(&htim4, TIM_FLAG_UPDATE);
+
+    // START由TIM4_TRGO直接触发TIM1单脉冲，相位与TIM4锁定，不受中断延迟影响
+    if (TDC_Pulse_Set_Trigger(TDC_PULSE_TRIG_TIM4) != HAL_OK)
+        return HAL_ERROR;
+    TDC_Pulse_Fire(1);  // 装载脉冲个数
+
+    TDC_Register_Callbacks(htdc, NULL, acq_cplt);
+    TDC_Register_Cal_Callback(htdc, acq_arm);
+    g_running = 1;
+    acq_arm(htdc);
+
+    if (HAL_TIM_Base_Start_IT(&htim4) != HAL_OK) {
+        g_running = 0;
+        return HAL_ERROR;
+    }
+    return HAL_OK;
+}
+
+/**
+ * @brief 开启STOP2参考通道的漂移补偿
+ */
+HAL_StatusTypeDef TDC_Acq_Set_Reference(TDC_HandleTypeDef *htdc, int64_t ref_ps, uint8_t shift) {
+    HAL_StatusTypeDef ret;
+
+    if (g_running)
+        return HAL_BUSY;
+    if (TDC_Get_Range(htdc) != TDC_RANGE_1)
+        return HAL_ERROR;  // 测量范围2只有STOP1
+
+    ret = TDC_Set_Hits(htdc, 1, 1);
+    if (ret != HAL_OK)
+        return ret;
+    TDC_Ref_Init(&g_ref, ref_ps, shift);
+    g_ref_on = 1;
+    g_dual_on = 0;
+    return HAL_OK;
+}
+
+/**
+ * @brief 关闭参考通道补偿
+ */
+void TDC_Acq_Clear_Reference(void) {
+    g_ref_on = 0;
+}
+
+/**
+ * @brief 获取参考通道补偿状态
+ * @note  漂移估计在中断中更新，关中断拷贝
+ */
+uint8_t TDC_Acq_Get_Reference(TDC_RefTypeDef *ref) {
+    uint32_t primask = __get_PRIMASK();
+
+    __disable_irq();
+    *ref = g_ref;
+    __set_PRIMASK(primask);
+    return g_ref_on;
+}
+
+/**
+ * @brief 开启双通道测量
+ */
+HAL_StatusTypeDef TDC_Acq_Set_Dual(TDC_HandleTypeDef *htdc) {
+    HAL_StatusTypeDef ret;
+
+    if (g_running)
+        return HAL_BUSY;
+    if (TDC_Get_Range(htdc) != TDC_RANGE_1)
+        return HAL_ERROR;  // 测量范围2只有STOP1
+
+    ret = TDC_Set_Hits(htdc, 1, 1);
+    if (ret != HAL_OK)
+        return ret;
+    g_dual_on = 1;
+    g_ref_on = 0;
+    return HAL_OK;
+}
+
+/**
+ * @brief 关闭双通道测量
+ */
+void TDC_Acq_Clear_Dual(void) {
+    g_dual_on = 0;
+}
+
+/**
+ * @brief 停止连续采集
+ */
+void TDC_Acq_Stop(void) {
+    if (!g_running)
+        return;
+
+    HAL_TIM_Base_Stop_IT(&htim4);
+    g_running = 0;
+    g_armed = 0;
+    TDC_Measure_Abort(g_htdc);
+    TDC_Register_Callbacks(g_htdc, NULL, NULL);
+    TDC_Register_Cal_Callback(g_htdc, NULL);
+    // TIM4已停止，等最后一个脉冲输出完再退出触发模式
+    while (TDC_Pulse_Set_Trigger(TDC_PULSE_TRIG_SOFTWARE) == HAL_BUSY) {
+    }
+}
+
+/**
+ * @brief 查询连续采集是否进行中
+ */
+uint8_t TDC_Acq_Is_Running(void) {
+    return g_running;
+}
+
+/**
+ * @brief 从环形缓冲区取出一条记录
+ */
+uint8_t TDC_Acq_Read(TDC_RecordTypeDef *rec) {
+    return TDC_Ring_Pop(&g_ring, rec);
+}
+
+/**
+ * @brief 获取采集计数
+ */
+void TDC_Acq_Get_Stats(TDC_AcqStatsTypeDef *stats) {
+    *stats = g_stats;
+    stats->overrun = g_ring.overrun;
+}
+
+/**
+ * @brief 获取第一个STOP时间的统计快照
+ */
+void TDC_Acq_Get_Time_Stats(TDC_StatsSnapshotTypeDef *snap) {
+    TDC_Stats_Snapshot(&g_time_stats[TDC_CH_STOP1], snap);
+}
+
+/**
+ * @brief 获取第一个STOP时间的分位数和直方图快照
+ */
+void TDC_Acq_Get_Dist(TDC_DistSnapshotTypeDef *snap) {
+    TDC_Dist_Snapshot(&g_dist[TDC_CH_STOP1], snap);
+}
+
+/**
+ * @brief 获取某个通道的时间统计快照
+ */
+HAL_StatusTypeDef TDC_Acq_Get_Channel_Stats(uint8_t ch, TDC_StatsSnapshotTypeDef *snap) {
+    if (ch >= TDC_CH_COUNT)
+        return HAL_ERROR;
+    TDC_Stats_Snapshot(&g_time_stats[ch], snap);
+    return HAL_OK;
+}
+
+/**
+ * @brief 获取某个通道的分位数和直方图快照
+ */
+HAL_StatusTypeDef TDC_Acq_Get_Channel_Dist(uint8_t ch, TDC_DistSnapshotTypeDef *snap) {
+    if (ch >= TDC_CH_COUNT)
+        return HAL_ERROR;
+    TDC_Dist_Snapshot(&g_dist[ch], snap);
+    return HAL_OK;
+}
+
+/**
+ * @brief 清零所有通道的时间统计和分布统计
+ */
+void TDC_Acq_Reset_Time_Stats(void) {
+    for (uint8_t ch = 0; ch < TDC_CH_COUNT; ch++) {
+        TDC_Stats_Reset(&g_time_stats[ch]);
+        TDC_Dist_Reset(&g_dist[ch]);
+    }
+}
+
+/**
+ * @brief 定时器更新中断回调
+ * @param htim 触发回调的定时器句柄
+ * @note 更新事件发生时START已经由硬件发出，这里只判断这个边沿是否落在Init之后，
+ *       并记录边沿时刻。中断进入时TIM4计数值就是边沿之后经过的时钟数。
+ */
+void HAL_TIM_PeriodElapsedCallback(TIM_HandleTypeDef *htim) {
+    uint32_t now, since;
+
+    if (htim->Instance != TIM4 || !g_running)
+        return;
+
+    now = DWT_Cycles();
+    since = __HAL_TIM_GET_COUNTER(&htim4) * (htim4.Instance->PSC + 1) * (SystemCoreClock / TIM4_Clock());
+
+    g_stats.triggers++;
+    if (g_armed && (now - g_t_armed) >= since) {
+        g_armed = 0;
+        g_t_start = now - since;
+    } else {
+        g_stats.missed++;  // 上一次测量还没有完成，或者Init晚于这个边沿
+
+        // 测量迟迟不完成说明TDC_INT丢失，恢复后重新准备
+        if (!g_armed && TDC_Is_Busy(g_htdc) &&
+            now - g_t_start > DWT_ns_to_cycles(TDC_ACQ_STALL_US * 1000U)) {
+            TDC_Measure_Abort(g_htdc);
+            TDC_Recover(g_htdc);
+            g_stats.recovered++;
+            acq_arm(g_htdc);
+        }
+    }
+}
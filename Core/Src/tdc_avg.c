@@ -0,0 +1,181 @@
+/**
+ * @file    tdc_avg.c
+ * @brief   START相位抖动的多次测量平均实现
+ */
+#include "tdc_avg.h"
+#include "tdc_pulse.h"
+#include "tdc_conv.h"
+
+/**
+ * @brief 16位伪随机序列 (x^16 + x^14 + x^13 + x^11 + 1)
+ */
+static uint16_t lfsr_next(uint16_t x) {
+    uint16_t bit = ((x >> 0) ^ (x >> 2) ^ (x >> 3) ^ (x >> 5)) & 1U;
+
+    return (x >> 1) | (uint16_t)(bit << 15);
+}
+
+/**
+ * @brief 95%双侧t分布临界值，Q8定点，下标为自由度 1-30
+ */
+static const uint16_t t95_q8[30] = {
+    3253, 1102, 815, 711, 658, 626, 605, 590, 579, 570,
+    563, 558, 553, 549, 546, 543, 540, 538, 536, 534,
+    532, 531, 530, 528, 527, 526, 525, 524, 524, 523,
+};
+
+/**
+ * @brief 自由度为df时的95%临界值 (Q8)
+ * @note  30以上按40、60、120分段取较大的值，区间只会偏宽
+ */
+static uint32_t t95(uint32_t df) {
+    if (df == 0)
+        return 0;
+    if (df <= 30)
+        return t95_q8[df - 1];
+    if (df <= 40)
+        return 523;  // 2.042
+    if (df <= 60)
+        return 517;  // 2.021
+    if (df <= 120)
+        return 512;  // 2.000
+    return 507;      // 1.980
+}
+
+/**
+ * @brief 第i次测量的START推迟量
+ */
+static uint32_t dither_ticks(const TDC_AvgConfigTypeDef *cfg, uint32_t i, uint16_t *lfsr) {
+    switch (cfg->dither) {
+    case TDC_DITHER_RAMP:
+        return i % cfg->steps;
+
+    case TDC_DITHER_PRBS:
+        *lfsr = lfsr_next(*lfsr);
+        return *lfsr % cfg->steps;
+
+    default:
+        return 0;
+    }
+}
+
+/**
+ * @brief 由统计结果计算分辨率
+ */
+static void avg_result(const TDC_WelfordTypeDef *w, TDC_AvgResultTypeDef *res) {
+    TDC_Welford_Result(w, &res->stats);
+
+    // 原始结果是16.16定点数，其最低位远小于GP22实际的量化步长，这里报告量化步长
+    res->lsb_q4 = TDC_GP22_LSB_PS * 16U;
+    res->res_q4 = res->stats.sem_q4;
+    res->gain_q8 = (res->res_q4 != 0) ? (uint32_t)(((uint64_t)res->lsb_q4 << 8) / res->res_q4) : 0;
+    if (res->stats.n > 1)
+        res->ci_q4 = (uint32_t)(((uint64_t)t95(res->stats.n - 1) * res->stats.sem_q4 + 128) >> 8);
+    else
+        res->ci_q4 = UINT32_MAX;  // 一个样本无法估计区间
+}
+
+/**
+ * @brief 当前样本的95%置信区间是否已经不大于目标
+ */
+static uint8_t ci_met(const TDC_WelfordTypeDef *w, const TDC_AvgConfigTypeDef *cfg) {
+    TDC_StatsResultTypeDef st;
+
+    if (w->n < cfg->min_n || w->n < 2)
+        return 0;
+    TDC_Welford_Result(w, &st);
+    return ((uint64_t)t95(w->n - 1) * st.sem_q4 + 128) >> 8 <= cfg->ci_q4;
+}
+
+/**
+ * @brief 进行一次抖动平均测量
+ * @note  每次测量前改变START相位；失败的测量不计入次数，由 max_fail 限制。
+ *        给定ci_q4时每个样本之后检查置信区间，区间按t分布计算，样本少时不会过早停止。
+ */
+HAL_StatusTypeDef TDC_Measure_Avg(TDC_HandleTypeDef *htdc, const TDC_AvgConfigTypeDef *cfg, TDC_AvgResultTypeDef *res) {
+    TDC_WelfordTypeDef w;
+    DWT_DeadlineTypeDef dl;
+    uint32_t tick_fs = TDC_Pulse_Tick_fs();
+    uint32_t i = 0, ticks, raw;
+    uint16_t lfsr = 0xACE1;
+    int64_t ps;
+    HAL_StatusTypeDef ret = HAL_OK;
+
+    // 次数和总时间都不限时，达不到的置信区间目标会使测量永不结束
+    if ((cfg->n == 0 && (cfg->ci_q4 == 0 || cfg->timeout == 0)) || (cfg->dither != TDC_DITHER_NONE && cfg->steps == 0))
+        return HAL_ERROR;
+    // 按标称时钟加回推迟量，HSI的偏差会变成与推迟量成正比的系统误差
+    if (cfg->compensate && !TDC_Pulse_Clock_Is_Calibrated())
+        return HAL_ERROR;
+
+    DWT_Deadline_us(&dl, cfg->timeout);
+    TDC_Welford_Reset(&w);
+    res->status = TDC_AVG_OK;
+    res->failed = 0;
+
+    for (;;) {
+        if (cfg->ci_q4 != 0 && ci_met(&w, cfg))
+            break;
+        if (cfg->n != 0 && w.n >= cfg->n) {
+            if (cfg->ci_q4 != 0) {
+                res->status = TDC_AVG_ABORT_COUNT;
+                ret = HAL_ERROR;
+            }
+            break;
+        }
+
+        if (cfg->timeout != 0 && DWT_Expired(&dl)) {
+            res->status = TDC_AVG_ABORT_TIME;
+            ret = HAL_TIMEOUT;
+            break;
+        }
+
+        ticks = dither_ticks(cfg, i++, &lfsr);
+        if (TDC_Pulse_Set_Delay(ticks) != HAL_OK) {
+            res->status = TDC_AVG_ABORT_DELAY;
+            ret = HAL_ERROR;
+            break;
+        }
+
+        if (TDC_Measure(htdc, &raw, cfg->shot_timeout) != 0) {
+            res->failed++;
+            if (cfg->max_fail != 0 && res->failed >= cfg->max_fail) {
+                res->status = TDC_AVG_ABORT_FAIL;
+                ret = HAL_ERROR;
+                break;
+            }
+            continue;
+        }
+
+        ps = TDC_Raw_to_ps(htdc, raw);
+        if (cfg->compensate)
+            ps += ((int64_t)ticks * tick_fs + 500) / 1000;  // START推迟，间隔同样变短
+        TDC_Welford_Add(&w, ps);
+
+        if (cfg->max_spread_ps != 0 && w.max - w.min > (int64_t)cfg->max_spread_ps) {
+            res->status = TDC_AVG_ABORT_SPREAD;
+            ret = HAL_ERROR;
+            break;
+        }
+    }
+
+    TDC_Pulse_Set_Delay(0);
+    avg_result(&w, res);
+    return ret;
+}
+
+/**
+ * @brief 测到给定精度为止
+ */
+HAL_StatusTypeDef TDC_Measure_Target(TDC_HandleTypeDef *htdc, uint32_t ci_q4, uint32_t timeout_us, TDC_AvgResultTypeDef *res) {
+    TDC_AvgConfigTypeDef cfg = TDC_AVG_CONFIG_DEFAULT;
+
+    // 不限次数，总时间是唯一的上限，目标达不到时必须靠它结束
+    if (ci_q4 == 0 || timeout_us == 0)
+        return HAL_ERROR;
+
+    cfg.n = 0;
+    cfg.ci_q4 = ci_q4;
+    cfg.timeout = timeout_us;
+    return TDC_Measure_Avg(htdc, &cfg, res);
+}
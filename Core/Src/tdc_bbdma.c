@@ -0,0 +1,226 @@
+/**
+ * @file    tdc_bbdma.c
+ * @brief   定时器节拍的DMA模拟SPI总线后端实现
+ * @details TIM3每个计数周期是半个SCK周期：CNT=1时CH1请求写下一个BSRR字，
+ *          CNT=ARR时CH2请求读一次IDR。同一周期内先写后读，所以第k个样本对应第k个波形字写出之后的引脚状态。
+ *          读IDR的流优先级更高，下一周期的写请求到达时上一次采样一定已经完成。
+ */
+#include "tdc_bbdma.h"
+#include "tdc.h"
+
+#if TDC_BBDMA_HALF_NS < TDC_T_SCK_HIGH_NS || TDC_BBDMA_HALF_NS < TDC_T_SCK_LOW_NS || TDC_BBDMA_HALF_NS <= TDC_T_SO_VALID_NS
+#error "TDC_BBDMA_HALF_NS is shorter than the GP22 SPI timing"
+#endif
+
+#define BB_STEPS (16 * (1 + TDC_IO_MAX_PAYLOAD))  // 每位两个半周期
+
+#define SSN(h, x) ((h)->ssn_port->BSRR = (x) ? (h)->ssn_pin : (uint32_t)(h)->ssn_pin << 16U)
+
+// 写入BSRR的值：低16位置位，高16位复位
+#define WAVE_SCK_HI ((uint32_t)TDC_SCK_Pin)
+#define WAVE_SCK_LO ((uint32_t)TDC_SCK_Pin << 16U)
+#define WAVE_SI_HI  ((uint32_t)TDC_SI_Pin)
+#define WAVE_SI_LO  ((uint32_t)TDC_SI_Pin << 16U)
+
+static TIM_HandleTypeDef htim_bb;          // TIM3，半个SCK周期的节拍
+static DMA_HandleTypeDef hdma_wave;        // DMA2 Stream0，波形表 -> BSRR
+static DMA_HandleTypeDef hdma_idr;         // DMA2 Stream1，IDR -> 样本
+
+static uint32_t g_wave[BB_STEPS];          // 波形表，奇数项固定为SCK拉低
+static uint32_t g_idr[BB_STEPS];           // 每个半周期末尾的IDR样本
+static uint8_t g_ready = 0;
+
+/**
+ * @brief 计算TIM3的计数时钟
+ * @note  APB1分频不为1时，定时器时钟是PCLK1的2倍
+ */
+static uint32_t TIM3_Clock(void) {
+    uint32_t clk = HAL_RCC_GetPCLK1Freq();
+
+    if ((RCC->D2CFGR & RCC_D2CFGR_D2PPRE1) != RCC_APB1_DIV1)
+        clk *= 2;
+    return clk;
+}
+
+/**
+ * @brief 配置TIM3：CH1、CH2只产生比较事件，不输出到引脚
+ * @param half 半个SCK周期的时钟数
+ */
+static HAL_StatusTypeDef tim_init(uint32_t half) {
+    TIM_OC_InitTypeDef sConfigOC = {0};
+
+    __HAL_RCC_TIM3_CLK_ENABLE();
+    htim_bb.Instance = TIM3;
+    htim_bb.Init.Prescaler = 0;
+    htim_bb.Init.CounterMode = TIM_COUNTERMODE_UP;
+    htim_bb.Init.Period = half - 1;
+    htim_bb.Init.ClockDivision = TIM_CLOCKDIVISION_DIV1;
+    htim_bb.Init.AutoReloadPreload = TIM_AUTORELOAD_PRELOAD_DISABLE;
+    if (HAL_TIM_OC_Init(&htim_bb) != HAL_OK)
+        return HAL_ERROR;
+
+    sConfigOC.OCMode = TIM_OCMODE_TIMING;
+    sConfigOC.OCPolarity = TIM_OCPOLARITY_HIGH;
+    sConfigOC.OCFastMode = TIM_OCFAST_DISABLE;
+    sConfigOC.Pulse = 1;          // 周期开始：改变SCK/SI
+    if (HAL_TIM_OC_ConfigChannel(&htim_bb, &sConfigOC, TIM_CHANNEL_1) != HAL_OK)
+        return HAL_ERROR;
+    sConfigOC.Pulse = half - 1;   // 周期末尾：采样SO
+    if (HAL_TIM_OC_ConfigChannel(&htim_bb, &sConfigOC, TIM_CHANNEL_2) != HAL_OK)
+        return HAL_ERROR;
+    return HAL_OK;
+}
+
+/**
+ * @brief 初始化一个普通模式的字传输DMA流
+ * @param priority 采样流优先级高于波形流
+ */
+static HAL_StatusTypeDef dma_init(DMA_HandleTypeDef *hdma, DMA_Stream_TypeDef *stream, uint32_t request,
+                                  uint32_t dir, uint32_t priority) {
+    hdma->Instance = stream;
+    hdma->Init.Request = request;
+    hdma->Init.Direction = dir;
+    hdma->Init.PeriphInc = DMA_PINC_DISABLE;
+    hdma->Init.MemInc = DMA_MINC_ENABLE;
+    hdma->Init.PeriphDataAlignment = DMA_PDATAALIGN_WORD;
+    hdma->Init.MemDataAlignment = DMA_MDATAALIGN_WORD;
+    hdma->Init.Mode = DMA_NORMAL;
+    hdma->Init.Priority = priority;
+    hdma->Init.FIFOMode = DMA_FIFOMODE_DISABLE;  // 直接模式，每个请求立即传输一个字
+    return HAL_DMA_Init(hdma);
+}
+
+/**
+ * @brief 写入一个字节的高电平半周期：SCK拉高，同时给出SI，高位在前
+ */
+static uint32_t *wave_write8(uint32_t *w, uint8_t b) {
+    for (uint8_t mask = 0x80; mask != 0; mask >>= 1, w += 2)
+        w[0] = WAVE_SCK_HI | ((b & mask) ? WAVE_SI_HI : WAVE_SI_LO);
+    return w;
+}
+
+/**
+ * @brief 读取一个字节的高电平半周期：只拉高SCK，SI保持不变
+ */
+static uint32_t *wave_read8(uint32_t *w) {
+    for (uint8_t i = 0; i < 8; i++, w += 2)
+        w[0] = WAVE_SCK_HI;
+    return w;
+}
+
+/**
+ * @brief 从高电平半周期的样本中取出一个字节，高位在前
+ */
+static uint8_t sample_read8(const uint32_t *s) {
+    uint8_t b = 0;
+
+    for (uint8_t i = 0; i < 8; i++, s += 2)
+        b = (uint8_t)(b << 1) | ((s[0] & TDC_SO_Pin) != 0);
+    return b;
+}
+
+/**
+ * @brief 按波形表的前steps项输出一次
+ * @return 1 完成；0 超时 (DMA没有在预期时间内收齐样本)
+ * @note  在关中断下调用，不能依赖HAL_GetTick，用DWT计时
+ */
+static uint8_t wave_run(uint32_t steps) {
+    DWT_DeadlineTypeDef dl;
+    uint8_t ok = 1;
+
+    if (HAL_DMA_Start(&hdma_idr, (uint32_t)&TDC_SO_GPIO_Port->IDR, (uint32_t)g_idr, steps) != HAL_OK ||
+        HAL_DMA_Start(&hdma_wave, (uint32_t)g_wave, (uint32_t)&TDC_SCK_GPIO_Port->BSRR, steps) != HAL_OK) {
+        HAL_DMA_Abort(&hdma_idr);
+        return 0;
+    }
+
+    TIM3->CNT = 0;
+    TIM3->SR = 0;
+    TIM3->DIER = TIM_DIER_CC1DE | TIM_DIER_CC2DE;
+    __HAL_TIM_ENABLE(&htim_bb);
+
+    DWT_Deadline_ns(&dl, steps * 2U * TDC_BBDMA_HALF_NS + 1000U);
+    while (DMA2_Stream1->CR & DMA_SxCR_EN) {  // 普通模式下传输完成后EN自动清零
+        if (DWT_Expired(&dl)) {
+            ok = 0;
+            break;
+        }
+    }
+
+    __HAL_TIM_DISABLE(&htim_bb);
+    TIM3->DIER = 0;
+    HAL_DMA_Abort(&hdma_wave);  // 复位HAL状态，下一次可以直接启动
+    HAL_DMA_Abort(&hdma_idr);
+    if (!ok)
+        TDC_SCK_GPIO_Port->BSRR = WAVE_SCK_LO;
+    return ok;
+}
+
+/**
+ * @brief DMA模拟SPI的一次片选事务
+ * @note  超时时读回的数据全部置0，与硬件SPI后端相同
+ */
+static void bbdma_transfer(TDC_HandleTypeDef *htdc, uint8_t opcode, const uint8_t *tx, uint8_t *rx, uint8_t len) {
+    uint32_t *w = wave_write8(g_wave, opcode);
+    uint8_t ok;
+
+    for (uint8_t i = 0; i < len; i++)
+        w = (rx != NULL) ? wave_read8(w) : wave_write8(w, tx[i]);
+
+    SSN(htdc, 0);
+    DWT_Delay_ns(TDC_T_SSN_SETUP_NS);
+    ok = wave_run(16U * (1U + len));
+    if (!ok)
+        htdc->err.io_timeout++;
+    DWT_Delay_ns(TDC_T_SSN_HOLD_NS);
+    SSN(htdc, 1);
+    DWT_Delay_ns(TDC_T_SSN_HIGH_NS);
+
+    if (rx != NULL) {
+        for (uint8_t i = 0; i < len; i++)
+            rx[i] = ok ? sample_read8(&g_idr[16 * (1 + i)]) : 0;
+    }
+}
+
+static const TDC_IO_OpsTypeDef bbdma_ops = {
+    .name = "bbdma",
+    .transfer = bbdma_transfer,
+};
+
+/**
+ * @brief 初始化TIM3和DMA
+ */
+HAL_StatusTypeDef TDC_BBDMA_Init(void) {
+    uint32_t half;
+
+    if (g_ready)
+        return HAL_OK;
+
+    // 一张BSRR表只能驱动一个端口
+    if (TDC_SCK_GPIO_Port != TDC_SI_GPIO_Port)
+        return HAL_ERROR;
+
+    // CH1和CH2必须落在同一周期内的不同时刻
+    half = (uint32_t)(((uint64_t)TDC_BBDMA_HALF_NS * TIM3_Clock() + 500000000U) / 1000000000U);
+    if (half < 3 || half > 65536)
+        return HAL_ERROR;
+
+    for (uint32_t i = 1; i < BB_STEPS; i += 2)
+        g_wave[i] = WAVE_SCK_LO;
+
+    __HAL_RCC_DMA2_CLK_ENABLE();
+    if (tim_init(half) != HAL_OK ||
+        dma_init(&hdma_wave, DMA2_Stream0, DMA_REQUEST_TIM3_CH1, DMA_MEMORY_TO_PERIPH, DMA_PRIORITY_HIGH) != HAL_OK ||
+        dma_init(&hdma_idr, DMA2_Stream1, DMA_REQUEST_TIM3_CH2, DMA_PERIPH_TO_MEMORY, DMA_PRIORITY_VERY_HIGH) != HAL_OK)
+        return HAL_ERROR;
+
+    g_ready = 1;
+    return HAL_OK;
+}
+
+/**
+ * @brief 获取后端操作表
+ */
+const TDC_IO_OpsTypeDef *TDC_BBDMA_Ops(void) {
+    return &bbdma_ops;
+}
@@ -0,0 +1,41 @@
+/**
+ * @file    tdc_conv.c
+ * @brief   GP22测量结果的整数时间换算实现
+ */
+#include "tdc_conv.h"
+
+/**
+ * @brief 获取当前换算系数
+ */
+void TDC_Get_Scale(TDC_HandleTypeDef *htdc, TDC_ScaleTypeDef *scale) {
+    scale->k = TDC_PS_SCALE(TDC_Get_Tref_fs(htdc));
+    scale->is_signed = (TDC_Get_Range(htdc) == TDC_RANGE_1);
+}
+
+/**
+ * @brief 按当前换算系数把一个原始结果换算为皮秒
+ */
+int64_t TDC_Raw_to_ps(TDC_HandleTypeDef *htdc, uint32_t raw) {
+    TDC_ScaleTypeDef scale;
+
+    TDC_Get_Scale(htdc, &scale);
+    return TDC_Fixed_to_ps(raw, &scale);
+}
+
+/**
+ * @brief 批量换算
+ * @note  每次处理4个样本，系数和符号判断只取一次
+ */
+void TDC_Raw_to_ps_Batch(const uint32_t *raw, int64_t *ps, uint32_t n, const TDC_ScaleTypeDef *scale) {
+    TDC_ScaleTypeDef s = *scale;
+    uint32_t i = 0;
+
+    for (; i + 4 <= n; i += 4) {
+        ps[i]     = TDC_Fixed_to_ps(raw[i], &s);
+        ps[i + 1] = TDC_Fixed_to_ps(raw[i + 1], &s);
+        ps[i + 2] = TDC_Fixed_to_ps(raw[i + 2], &s);
+        ps[i + 3] = TDC_Fixed_to_ps(raw[i + 3], &s);
+    }
+    for (; i < n; i++)
+        ps[i] = TDC_Fixed_to_ps(raw[i], &s);
+}
@@ -0,0 +1,194 @@
+/**
+ * @file    tdc_dist.c
+ * @brief   流式分位数和定宽直方图实现
+ * @details P²算法 (Jain & Chlamtac, 1985)：5个标记的期望位置按分位数匀速前进，
+ *          实际位置偏离超过1时用抛物线 (失败时用直线) 插值移动标记高度。
+ *          抛物线公式中先算两侧斜率再乘位置差，斜率放大2^16保留精度，中间结果不会溢出。
+ */
+#include "tdc_dist.h"
+
+static const uint16_t g_quantiles[TDC_DIST_NQ] = TDC_DIST_QUANTILES;
+
+//----------------- P²分位数 -----------------
+
+/**
+ * @brief 初始化估计器
+ * @param permille 分位数，单位千分之一
+ */
+static void p2_init(TDC_P2TypeDef *e, uint16_t permille) {
+    uint32_t p = ((uint32_t)permille << 16) / 1000;
+
+    e->count = 0;
+    e->dn_q16[0] = 0;
+    e->dn_q16[1] = p / 2;
+    e->dn_q16[2] = p;
+    e->dn_q16[3] = (65536 + p) / 2;
+    e->dn_q16[4] = 65536;
+}
+
+/**
+ * @brief 抛物线插值
+ * @param d 移动方向，+1或-1
+ */
+static int64_t p2_parabolic(const TDC_P2TypeDef *e, int i, int d) {
+    int64_t nl = e->n[i] - e->n[i - 1];
+    int64_t nr = e->n[i + 1] - e->n[i];
+    int64_t sl = ((e->q[i] - e->q[i - 1]) << 16) / nl;
+    int64_t sr = ((e->q[i + 1] - e->q[i]) << 16) / nr;
+    int64_t t = (nl + d) * sr + (nr - d) * sl;
+
+    return e->q[i] + d * t / (nl + nr) / 65536;
+}
+
+/**
+ * @brief 加入一个样本
+ * @param x 样本，单位ps，Q4定点
+ */
+static void p2_add(TDC_P2TypeDef *e, int64_t x) {
+    int k, i, d;
+    int64_t qp, dn;
+
+    // 前5个样本直接保存并保持有序
+    if (e->count < 5) {
+        for (i = e->count; i > 0 && e->q[i - 1] > x; i--)
+            e->q[i] = e->q[i - 1];
+        e->q[i] = x;
+        if (++e->count == 5) {
+            for (i = 0; i < 5; i++) {
+                e->n[i] = i + 1;
+                e->np_q16[i] = 65536 + 4 * (int64_t)e->dn_q16[i];
+            }
+        }
+        return;
+    }
+    e->count++;
+
+    // 找到样本所在的区间，超出两端时更新最小值、最大值
+    if (x < e->q[0]) {
+        e->q[0] = x;
+        k = 0;
+    } else if (x >= e->q[4]) {
+        e->q[4] = x;
+        k = 3;
+    } else {
+        for (k = 0; k < 3 && x >= e->q[k + 1]; k++) {
+        }
+    }
+
+    for (i = k + 1; i < 5; i++)
+        e->n[i]++;
+    for (i = 0; i < 5; i++)
+        e->np_q16[i] += e->dn_q16[i];
+
+    // 调整中间3个标记
+    for (i = 1; i < 4; i++) {
+        dn = e->np_q16[i] - (e->n[i] << 16);
+        if ((dn >= 65536 && e->n[i + 1] - e->n[i] > 1) || (dn <= -65536 && e->n[i - 1] - e->n[i] < -1)) {
+            d = (dn > 0) ? 1 : -1;
+            qp = p2_parabolic(e, i, d);
+            if (e->q[i - 1] < qp && qp < e->q[i + 1])
+                e->q[i] = qp;
+            else
+                e->q[i] += d * (e->q[i + d] - e->q[i]) / (e->n[i + d] - e->n[i]);
+            e->n[i] += d;
+        }
+    }
+}
+
+/**
+ * @brief 当前估计
+ * @note  不足5个样本时直接取已排序样本中最接近的一个
+ */
+static int64_t p2_get(const TDC_P2TypeDef *e, uint16_t permille) {
+    if (e->count == 0)
+        return 0;
+    if (e->count < 5)
+        return e->q[((e->count - 1) * permille + 500) / 1000];
+    return e->q[2];
+}
+
+//----------------- 对外接口 -----------------
+
+/**
+ * @brief 初始化分布统计
+ */
+void TDC_Dist_Init(TDC_DistTypeDef *d, int64_t lo_ps, uint32_t bin_ps, uint8_t auto_center) {
+    d->lo_ps = lo_ps;
+    d->bin_ps = bin_ps ? bin_ps : 1;
+    d->auto_center = auto_center;
+    d->seq = 0;
+    TDC_Dist_Reset(d);
+}
+
+/**
+ * @brief 清零
+ * @note  生产者在中断里运行，这里关中断保证清零不被打断
+ */
+void TDC_Dist_Reset(TDC_DistTypeDef *d) {
+    uint32_t primask = __get_PRIMASK();
+
+    __disable_irq();
+    d->seq++;
+    for (uint8_t i = 0; i < TDC_DIST_NQ; i++)
+        p2_init(&d->p2[i], g_quantiles[i]);
+    for (uint32_t i = 0; i < TDC_HIST_BINS; i++)
+        d->bins[i] = 0;
+    d->under = 0;
+    d->over = 0;
+    d->n = 0;
+    d->seq++;
+    __set_PRIMASK(primask);
+}
+
+/**
+ * @brief 加入一个样本
+ */
+void TDC_Dist_Add(TDC_DistTypeDef *d, int64_t ps) {
+    int64_t off;
+
+    d->seq++;
+    __DMB();  // 先标记为正在更新，再改数据
+
+    if (d->n == 0 && d->auto_center)
+        d->lo_ps = ps - (int64_t)d->bin_ps * (TDC_HIST_BINS / 2);
+    d->n++;
+
+    for (uint8_t i = 0; i < TDC_DIST_NQ; i++)
+        p2_add(&d->p2[i], ps * 16);
+
+    off = ps - d->lo_ps;
+    if (off < 0)
+        d->under++;
+    else if (off >= (int64_t)d->bin_ps * TDC_HIST_BINS)
+        d->over++;
+    else
+        d->bins[(uint32_t)off / d->bin_ps]++;
+
+    __DMB();  // 数据写完之后再结束更新
+    d->seq++;
+}
+
+/**
+ * @brief 取得一致的快照
+ * @note  拷贝期间如果生产者更新过 (序号变化或为奇数) 就重新拷贝
+ */
+void TDC_Dist_Snapshot(const TDC_DistTypeDef *d, TDC_DistSnapshotTypeDef *snap) {
+    uint32_t seq;
+
+    do {
+        seq = d->seq;
+        __DMB();
+        snap->n = d->n;
+        for (uint8_t i = 0; i < TDC_DIST_NQ; i++) {
+            snap->p[i] = g_quantiles[i];
+            snap->q_q4[i] = p2_get(&d->p2[i], g_quantiles[i]);
+        }
+        snap->lo_ps = d->lo_ps;
+        snap->bin_ps = d->bin_ps;
+        for (uint32_t i = 0; i < TDC_HIST_BINS; i++)
+            snap->bins[i] = d->bins[i];
+        snap->under = d->under;
+        snap->over = d->over;
+        __DMB();
+    } while ((seq & 1) || seq != d->seq);
+}
@@ -0,0 +1,342 @@
+/**
+ * @file    tdc_dma.c
+ * @brief   由TDC_INT触发的DMA结果读出实现
+ * @details DMAMUX1请求发生器的触发源只有EXTI0和DMAMUX1通道0-2的事件，
+ *          所以需要产生事件的两步 (SSN拉低、收齐5个字节) 放在DMA1 Stream1、Stream2 (DMAMUX1通道1、2)：
+ *
+ *            EXTI0 ──> 发生器0 ──> Stream1  SSN拉低 ──事件──> 发生器1 ──> Stream3  5字节 -> TXDR
+ *                  └─> 发生器3 ──> Stream5  清EXTI0挂起                        │
+ *                                                                           SPI时钟
+ *                                                                              │
+ *            Stream2  RXDR -> 环形缓冲区 (SPI RX请求) ──事件 (5个请求)──> 发生器2 ──> Stream4  SSN拉高
+ *
+ *          SPI以TSIZE=0一直处于传输状态，主机在TX FIFO为空时停止SCK，
+ *          所以每次发生器1送入5个字节，SPI就正好完成一次5字节的片选事务。
+ */
+#include "tdc_dma.h"
+#include "tdc_io.h"
+#include "tdc_acq.h"
+#include "tdc_pulse.h"
+#include "tim.h"
+
+#define DMA_FRAME 5                        // 操作码 + 4字节结果
+
+static DMA_HandleTypeDef hdma_ssn_lo;      // DMA1 Stream1，SSN拉低
+static DMA_HandleTypeDef hdma_rx;          // DMA1 Stream2，SPI接收
+static DMA_HandleTypeDef hdma_tx;          // DMA1 Stream3，SPI发送
+static DMA_HandleTypeDef hdma_ssn_hi;      // DMA1 Stream4，SSN拉高
+static DMA_HandleTypeDef hdma_exti;        // DMA1 Stream5，清EXTI0挂起
+
+static const uint8_t g_tx[DMA_FRAME] = {0xB0, 0xFF, 0xFF, 0xFF, 0xFF};  // READ RES_0
+static uint8_t g_rx[DMA_FRAME * TDC_DMA_SHOTS];                         // 接收环形缓冲区
+static uint32_t g_raw[TDC_DMA_SHOTS / 2];                               // 半个缓冲区的结果
+static uint32_t g_ssn_lo, g_ssn_hi, g_exti_clr;                         // 写入BSRR和PR1的值
+
+static TDC_HandleTypeDef *g_htdc = NULL;
+static TDC_ConfigTypeDef g_saved_cfg;      // 开始前的配置，停止时恢复
+static TDC_DMA_BlockCallbackTypeDef g_block_cb = NULL;
+static TDC_DMAStatsTypeDef g_stats;
+static uint8_t g_running = 0;
+
+/**
+ * @brief SPI实例对应的DMAMUX接收请求
+ * @return 请求号，0表示不支持 (SPI6只能使用BDMA)
+ */
+static uint32_t spi_rx_request(SPI_TypeDef *spi) {
+    if (spi == SPI1)
+        return DMA_REQUEST_SPI1_RX;
+    if (spi == SPI2)
+        return DMA_REQUEST_SPI2_RX;
+    if (spi == SPI3)
+        return DMA_REQUEST_SPI3_RX;
+    if (spi == SPI4)
+        return DMA_REQUEST_SPI4_RX;
+    if (spi == SPI5)
+        return DMA_REQUEST_SPI5_RX;
+    return 0;
+}
+
+/**
+ * @brief 初始化一个循环模式的DMA流
+ * @param align 外设和存储器的数据宽度，DMA_PDATAALIGN_BYTE 或 DMA_PDATAALIGN_WORD
+ * @param minc 存储器地址是否递增
+ */
+static HAL_StatusTypeDef dma_init(DMA_HandleTypeDef *hdma, DMA_Stream_TypeDef *stream, uint32_t request,
+                                  uint32_t dir, uint32_t align, uint32_t minc) {
+    hdma->Instance = stream;
+    hdma->Init.Request = request;
+    hdma->Init.Direction = dir;
+    hdma->Init.PeriphInc = DMA_PINC_DISABLE;
+    hdma->Init.MemInc = minc;
+    hdma->Init.PeriphDataAlignment = align;
+    hdma->Init.MemDataAlignment = (align == DMA_PDATAALIGN_WORD) ? DMA_MDATAALIGN_WORD : DMA_MDATAALIGN_BYTE;
+    hdma->Init.Mode = DMA_CIRCULAR;  // 每次触发后自动重装，不需要CPU重新准备
+    hdma->Init.Priority = DMA_PRIORITY_VERY_HIGH;
+    hdma->Init.FIFOMode = DMA_FIFOMODE_DISABLE;
+    return HAL_DMA_Init(hdma);
+}
+
+/**
+ * @brief 配置DMA流对应的请求发生器
+ * @param signal 触发信号，HAL_DMAMUX1_REQ_GEN_xxx
+ * @param n 每次触发产生的请求个数
+ */
+static HAL_StatusTypeDef gen_init(DMA_HandleTypeDef *hdma, uint32_t signal, uint32_t n) {
+    HAL_DMA_MuxRequestGeneratorConfigTypeDef gen = {0};
+
+    gen.SignalID = signal;
+    gen.Polarity = HAL_DMAMUX_REQ_GEN_RISING;
+    gen.RequestNumber = n;
+    if (HAL_DMAEx_ConfigMuxRequestGenerator(hdma, &gen) != HAL_OK)
+        return HAL_ERROR;
+    return HAL_DMAEx_EnableMuxRequestGenerator(hdma);
+}
+
+/**
+ * @brief 让DMAMUX通道每转发n个请求产生一次事件，作为下一个发生器的触发源
+ */
+static HAL_StatusTypeDef event_init(DMA_HandleTypeDef *hdma, uint32_t n) {
+    HAL_DMA_MuxSyncConfigTypeDef sync = {0};
+
+    sync.SyncSignalID = HAL_DMAMUX1_SYNC_EXTI0;
+    sync.SyncPolarity = HAL_DMAMUX_SYNC_NO_EVENT;
+    sync.SyncEnable = DISABLE;
+    sync.EventEnable = ENABLE;
+    sync.RequestNumber = n;
+    return HAL_DMAEx_ConfigMuxSync(hdma, &sync);
+}
+
+/**
+ * @brief 把半个接收缓冲区解包为结果并交给回调
+ * @param frame 接收缓冲区中第一个结果的位置，第一个字节是发送操作码期间收到的空数据
+ */
+static void rx_block(const uint8_t *frame) {
+    for (uint32_t i = 0; i < TDC_DMA_SHOTS / 2; i++, frame += DMA_FRAME)
+        g_raw[i] = ((uint32_t)frame[1] << 24) | ((uint32_t)frame[2] << 16) | ((uint32_t)frame[3] << 8) | frame[4];
+
+    g_stats.blocks++;
+    g_stats.shots += TDC_DMA_SHOTS / 2;
+    if (g_block_cb != NULL)
+        g_block_cb(g_raw, TDC_DMA_SHOTS / 2);
+}
+
+static void rx_half(DMA_HandleTypeDef *hdma) {
+    rx_block(g_rx);
+}
+
+static void rx_full(DMA_HandleTypeDef *hdma) {
+    rx_block(g_rx + DMA_FRAME * TDC_DMA_SHOTS / 2);
+}
+
+static void rx_error(DMA_HandleTypeDef *hdma) {
+    g_stats.errors++;
+}
+
+/**
+ * @brief 配置TDC_INT的第二路输入：下降沿置位EXTI0，不开启NVIC中断，只作为DMAMUX的触发源
+ */
+static void exti0_init(void) {
+    GPIO_InitTypeDef GPIO_InitStruct = {0};
+
+    __HAL_RCC_GPIOD_CLK_ENABLE();
+    GPIO_InitStruct.Pin = TDC_DMA_INT_PIN;
+    GPIO_InitStruct.Mode = GPIO_MODE_IT_FALLING;
+    GPIO_InitStruct.Pull = GPIO_NOPULL;
+    HAL_GPIO_Init(TDC_DMA_INT_PORT, &GPIO_InitStruct);
+    __HAL_GPIO_EXTI_CLEAR_IT(TDC_DMA_INT_PIN);
+}
+
+/**
+ * @brief 配置并启动DMA链，先启动后级，最后启动由EXTI0触发的第一级
+ */
+static HAL_StatusTypeDef chain_start(SPI_TypeDef *spi, GPIO_TypeDef *ssn_port, uint16_t ssn_pin) {
+    uint32_t rx_req = spi_rx_request(spi);
+
+    if (rx_req == 0)
+        return HAL_ERROR;
+
+    g_ssn_lo = (uint32_t)ssn_pin << 16U;
+    g_ssn_hi = ssn_pin;
+    g_exti_clr = TDC_DMA_INT_PIN;
+
+    __HAL_RCC_DMA1_CLK_ENABLE();
+    if (dma_init(&hdma_ssn_lo, DMA1_Stream1, DMA_REQUEST_GENERATOR0, DMA_MEMORY_TO_PERIPH, DMA_PDATAALIGN_WORD, DMA_MINC_DISABLE) != HAL_OK ||
+        dma_init(&hdma_rx, DMA1_Stream2, rx_req, DMA_PERIPH_TO_MEMORY, DMA_PDATAALIGN_BYTE, DMA_MINC_ENABLE) != HAL_OK ||
+        dma_init(&hdma_tx, DMA1_Stream3, DMA_REQUEST_GENERATOR1, DMA_MEMORY_TO_PERIPH, DMA_PDATAALIGN_BYTE, DMA_MINC_ENABLE) != HAL_OK ||
+        dma_init(&hdma_ssn_hi, DMA1_Stream4, DMA_REQUEST_GENERATOR2, DMA_MEMORY_TO_PERIPH, DMA_PDATAALIGN_WORD, DMA_MINC_DISABLE) != HAL_OK ||
+        dma_init(&hdma_exti, DMA1_Stream5, DMA_REQUEST_GENERATOR3, DMA_MEMORY_TO_PERIPH, DMA_PDATAALIGN_WORD, DMA_MINC_DISABLE) != HAL_OK)
+        return HAL_ERROR;
+
+    // 通道1每转发1个请求 (SSN拉低) 产生事件；通道2每转发5个请求 (收齐一次结果) 产生事件
+    if (event_init(&hdma_ssn_lo, 1) != HAL_OK || event_init(&hdma_rx, DMA_FRAME) != HAL_OK)
+        return HAL_ERROR;
+    if (gen_init(&hdma_tx, HAL_DMAMUX1_REQ_GEN_DMAMUX1_CH1_EVT, DMA_FRAME) != HAL_OK ||
+        gen_init(&hdma_ssn_hi, HAL_DMAMUX1_REQ_GEN_DMAMUX1_CH2_EVT, 1) != HAL_OK ||
+        gen_init(&hdma_exti, HAL_DMAMUX1_REQ_GEN_EXTI0, 1) != HAL_OK ||
+        gen_init(&hdma_ssn_lo, HAL_DMAMUX1_REQ_GEN_EXTI0, 1) != HAL_OK)
+        return HAL_ERROR;
+
+    hdma_rx.XferHalfCpltCallback = rx_half;
+    hdma_rx.XferCpltCallback = rx_full;
+    hdma_rx.XferErrorCallback = rx_error;
+    HAL_NVIC_SetPriority(DMA1_Stream2_IRQn, 0, 0);
+    HAL_NVIC_EnableIRQ(DMA1_Stream2_IRQn);
+
+    if (HAL_DMA_Start_IT(&hdma_rx, (uint32_t)&spi->RXDR, (uint32_t)g_rx, sizeof(g_rx)) != HAL_OK ||
+        HAL_DMA_Start(&hdma_ssn_hi, (uint32_t)&g_ssn_hi, (uint32_t)&ssn_port->BSRR, 1) != HAL_OK ||
+        HAL_DMA_Start(&hdma_tx, (uint32_t)g_tx, (uint32_t)&spi->TXDR, DMA_FRAME) != HAL_OK ||
+        HAL_DMA_Start(&hdma_exti, (uint32_t)&g_exti_clr, (uint32_t)&EXTI_D1->PR1, 1) != HAL_OK ||
+        HAL_DMA_Start(&hdma_ssn_lo, (uint32_t)&g_ssn_lo, (uint32_t)&ssn_port->BSRR, 1) != HAL_OK)
+        return HAL_ERROR;
+    return HAL_OK;
+}
+
+/**
+ * @brief 停止DMA链，先停第一级
+ */
+static void chain_stop(void) {
+    HAL_DMAEx_DisableMuxRequestGenerator(&hdma_ssn_lo);
+    HAL_DMAEx_DisableMuxRequestGenerator(&hdma_exti);
+    HAL_DMAEx_DisableMuxRequestGenerator(&hdma_tx);
+    HAL_DMAEx_DisableMuxRequestGenerator(&hdma_ssn_hi);
+    HAL_NVIC_DisableIRQ(DMA1_Stream2_IRQn);
+
+    HAL_DMA_Abort(&hdma_ssn_lo);
+    HAL_DMA_Abort(&hdma_exti);
+    HAL_DMA_Abort(&hdma_tx);
+    HAL_DMA_Abort(&hdma_rx);
+    HAL_DMA_Abort(&hdma_ssn_hi);
+}
+
+/**
+ * @brief SPI进入TSIZE=0的连续传输，接收DMA请求打开，发送由DMA链直接写TXDR
+ * @note  HAL_SPI_TransmitReceive() 每次结束时关闭SPE，这里可以直接修改CFG1
+ */
+static void spi_stream_start(SPI_TypeDef *spi) {
+    CLEAR_BIT(spi->CR1, SPI_CR1_SPE);
+    MODIFY_REG(spi->CFG1, SPI_CFG1_TXDMAEN | SPI_CFG1_FTHLV, SPI_CFG1_RXDMAEN);  // 每收到1个字节请求一次
+    MODIFY_REG(spi->CR2, SPI_CR2_TSIZE, 0);
+    spi->IFCR = 0xFFFFFFFFU;
+    SET_BIT(spi->CR1, SPI_CR1_SPE);
+    SET_BIT(spi->CR1, SPI_CR1_CSTART);
+}
+
+/**
+ * @brief 结束连续传输，恢复HAL使用的状态
+ */
+static void spi_stream_stop(SPI_TypeDef *spi) {
+    if (spi->CR1 & SPI_CR1_CSTART) {
+        SET_BIT(spi->CR1, SPI_CR1_CSUSP);
+        while (spi->CR1 & SPI_CR1_CSTART) {
+        }
+    }
+    CLEAR_BIT(spi->CR1, SPI_CR1_SPE);
+    CLEAR_BIT(spi->CFG1, SPI_CFG1_RXDMAEN);
+    spi->IFCR = 0xFFFFFFFFU;
+}
+
+/**
+ * @brief 开始DMA读出
+ */
+HAL_StatusTypeDef TDC_DMA_Start(TDC_HandleTypeDef *htdc, uint32_t rate_hz, TDC_DMA_BlockCallbackTypeDef block_cb) {
+    TDC_ConfigTypeDef cfg;
+
+    if (g_running || TDC_Acq_Is_Running())
+        return HAL_BUSY;  // 连续采集也使用TIM4和TDC_INT
+    if (htdc->hspi == NULL || TDC_IO_Get_Transport(htdc) != TDC_TRANSPORT_SPI || TDC_Get_Range(htdc) != TDC_RANGE_1)
+        return HAL_ERROR;
+    if (TDC_Is_Busy(htdc))
+        return HAL_BUSY;
+    if (TDC_Acq_Set_Rate(rate_hz) != HAL_OK)
+        return HAL_ERROR;
+
+    // STOP1单脉冲，ALU直接算出STOP1-START；快速初始化使芯片收到中断后自行准备下一次测量
+    TDC_Config_Get(htdc, &g_saved_cfg);
+    cfg = g_saved_cfg;
+    cfg.reg1.hit2 = 0;
+    cfg.reg1.hit1 = 1;
+    cfg.reg1.hitin1 = 1;
+    cfg.reg1.hitin2 = 0;
+    cfg.reg1.en_fast_init = 1;
+    if (TDC_Config_Apply(htdc, &cfg) != HAL_OK)
+        return HAL_BUSY;
+    TDC_IO_Write8(htdc, 0x70);
+
+    g_htdc = htdc;
+    g_block_cb = block_cb;
+    g_stats.blocks = 0;
+    g_stats.shots = 0;
+    g_stats.errors = 0;
+
+    // TDC_INT不再进入CPU中断，由EXTI0触发DMA
+    EXTI_D1->IMR1 &= ~(uint32_t)htdc->int_pin;
+    exti0_init();
+    spi_stream_start(htdc->hspi->Instance);
+    if (chain_start(htdc->hspi->Instance, htdc->ssn_port, htdc->ssn_pin) != HAL_OK) {
+        chain_stop();
+        spi_stream_stop(htdc->hspi->Instance);
+        EXTI_D1->IMR1 |= htdc->int_pin;
+        TDC_Config_Apply(htdc, &g_saved_cfg);
+        return HAL_ERROR;
+    }
+    g_running = 1;
+
+    // START由TIM4_TRGO触发TIM1单脉冲，周期性发出，不需要CPU
+    TDC_Pulse_Set_Trigger(TDC_PULSE_TRIG_TIM4);
+    TDC_Pulse_Fire(1);
+    __HAL_TIM_SET_COUNTER(&htim4, 0);
+    HAL_TIM_Base_Start(&htim4);
+    return HAL_OK;
+}
+
+/**
+ * @brief 停止DMA读出
+ * @note  等待最后一次事务结束后再拉高SSN，恢复TDC_INT中断和原来的配置
+ */
+void TDC_DMA_Stop(void) {
+    TDC_HandleTypeDef *htdc = g_htdc;
+
+    if (!g_running)
+        return;
+
+    HAL_TIM_Base_Stop(&htim4);
+    // TIM4已停止，等最后一个脉冲输出完再退出触发模式
+    while (TDC_Pulse_Set_Trigger(TDC_PULSE_TRIG_SOFTWARE) == HAL_BUSY) {
+    }
+
+    chain_stop();
+    spi_stream_stop(htdc->hspi->Instance);
+    htdc->ssn_port->BSRR = htdc->ssn_pin;
+    HAL_GPIO_DeInit(TDC_DMA_INT_PORT, TDC_DMA_INT_PIN);
+    g_running = 0;
+
+    TDC_Config_Apply(htdc, &g_saved_cfg);
+    TDC_IO_Write8(htdc, 0x70);
+    __HAL_GPIO_EXTI_CLEAR_IT(htdc->int_pin);
+    EXTI_D1->IMR1 |= htdc->int_pin;
+}
+
+/**
+ * @brief 查询DMA读出是否进行中
+ */
+uint8_t TDC_DMA_Is_Running(void) {
+    return g_running;
+}
+
+/**
+ * @brief 获取DMA读出计数
+ */
+void TDC_DMA_Get_Stats(TDC_DMAStatsTypeDef *stats) {
+    uint32_t primask = __get_PRIMASK();
+
+    __disable_irq();
+    *stats = g_stats;
+    __set_PRIMASK(primask);
+}
+
+/**
+ * @brief 结果DMA中断处理
+ */
+void TDC_DMA_IRQHandler(void) {
+    HAL_DMA_IRQHandler(&hdma_rx);
+}
@@ -0,0 +1,363 @@
+/**
+ * @file    tdc_filter.c
+ * @brief   测量结果的静态滤波流水线实现
+ */
+#include "tdc_filter.h"
+
+//----------------- 滑动中值 -----------------
+
+#define HEAP(m, i)  ((m)->heap[(i) + (m)->w / 2])
+#define MIN_CT(m)   (((m)->ct - 1) / 2)  // 最小堆中的样本数
+#define MAX_CT(m)   ((m)->ct / 2)        // 最大堆中的样本数
+
+/**
+ * @brief 堆位置i的样本是否小于位置j的样本
+ */
+static inline int med_less(const TDC_MedianTypeDef *m, int i, int j) {
+    return m->data[HEAP(m, i)] < m->data[HEAP(m, j)];
+}
+
+/**
+ * @brief 交换堆位置i和j，同时更新位置表
+ */
+static inline int med_swap(TDC_MedianTypeDef *m, int i, int j) {
+    int8_t t = HEAP(m, i);
+
+    HEAP(m, i) = HEAP(m, j);
+    HEAP(m, j) = t;
+    m->pos[HEAP(m, i)] = (int8_t)i;
+    m->pos[HEAP(m, j)] = (int8_t)j;
+    return 1;
+}
+
+/**
+ * @brief 位置i小于位置j时交换，返回是否交换
+ */
+static inline int med_cmp_swap(TDC_MedianTypeDef *m, int i, int j) {
+    return med_less(m, i, j) && med_swap(m, i, j);
+}
+
+/**
+ * @brief 从位置i开始向下调整最小堆，i与其父节点 i/2 比较
+ * @note  i为1时父节点是中值
+ */
+static void min_down(TDC_MedianTypeDef *m, int i) {
+    for (; i <= MIN_CT(m); i *= 2) {
+        if (i > 1 && i < MIN_CT(m) && med_less(m, i + 1, i))
+            i++;
+        if (!med_cmp_swap(m, i, i / 2))
+            break;
+    }
+}
+
+/**
+ * @brief 从位置i (负数) 开始向下调整最大堆，i与其父节点 i/2 比较
+ */
+static void max_down(TDC_MedianTypeDef *m, int i) {
+    for (; i >= -MAX_CT(m); i *= 2) {
+        if (i < -1 && i > -MAX_CT(m) && med_less(m, i, i - 1))
+            i--;
+        if (!med_cmp_swap(m, i / 2, i))
+            break;
+    }
+}
+
+/**
+ * @brief 最小堆中位置i向上调整，返回是否到达中值位置
+ */
+static int min_up(TDC_MedianTypeDef *m, int i) {
+    while (i > 0 && med_cmp_swap(m, i, i / 2))
+        i /= 2;
+    return i == 0;
+}
+
+/**
+ * @brief 最大堆中位置i向上调整，返回是否到达中值位置
+ */
+static int max_up(TDC_MedianTypeDef *m, int i) {
+    while (i < 0 && med_cmp_swap(m, i / 2, i))
+        i /= 2;
+    return i == 0;
+}
+
+/**
+ * @brief 初始化中值窗口
+ * @note  预先排好位置：中值、最大堆、最小堆、最大堆……，窗口未满时也能直接插入
+ */
+static void median_init(TDC_MedianTypeDef *m, uint8_t w) {
+    int n;
+
+    m->w = w;
+    m->idx = 0;
+    m->ct = 0;
+    for (n = w - 1; n >= 0; n--) {
+        m->pos[n] = (int8_t)(((n + 1) / 2) * ((n & 1) ? -1 : 1));
+        HEAP(m, m->pos[n]) = (int8_t)n;
+    }
+}
+
+/**
+ * @brief 加入一个样本，替换窗口中最旧的样本
+ */
+static void median_insert(TDC_MedianTypeDef *m, int64_t v) {
+    int is_new = m->ct < m->w;
+    int p = m->pos[m->idx];
+    int64_t old = m->data[m->idx];
+
+    m->data[m->idx] = v;
+    m->idx = (m->idx + 1 == m->w) ? 0 : m->idx + 1;
+    m->ct += is_new;
+
+    if (p > 0) {
+        if (!is_new && old < v)
+            min_down(m, p * 2);
+        else if (min_up(m, p))
+            max_down(m, -1);
+    } else if (p < 0) {
+        if (!is_new && v < old)
+            max_down(m, p * 2);
+        else if (max_up(m, p))
+            min_down(m, 1);
+    } else {
+        if (MAX_CT(m))
+            max_down(m, -1);
+        if (MIN_CT(m))
+            min_down(m, 1);
+    }
+}
+
+/**
+ * @brief 当前中值，样本数为偶数时取中间两个的平均
+ */
+static int64_t median_get(const TDC_MedianTypeDef *m) {
+    int64_t v = m->data[HEAP(m, 0)];
+
+    if ((m->ct & 1) == 0)
+        v = (v + m->data[HEAP(m, -1)]) / 2;
+    return v;
+}
+
+//----------------- 各级处理 -----------------
+
+/**
+ * @brief Hampel判断
+ * @return 1表示有输出
+ */
+static uint8_t hampel_process(TDC_HampelTypeDef *h, int64_t x, int64_t *y, uint8_t *outlier) {
+    int64_t med, dev, lim, lim_min;
+    uint8_t full = h->value.ct == h->value.w;
+
+    *outlier = 0;
+    *y = x;
+    if (h->value.ct != 0) {
+        med = median_get(&h->value);
+        dev = (x > med) ? x - med : med - x;
+
+        if (full) {
+            // 1.4826 * k * MAD，1.4826 = 97163 / 65536
+            lim = (int64_t)(((uint64_t)median_get(&h->dev) * 97163U * h->k_q8) >> 24);
+            // 结果是量化的，窗口内大多相同时MAD为0，门限不小于k个量化步长
+            lim_min = (int64_t)(((uint64_t)TDC_GP22_LSB_PS * h->k_q8) >> 8);
+            if (lim < lim_min)
+                lim = lim_min;
+            if (dev > lim) {
+                *outlier = 1;
+                *y = med;
+            }
+        }
+        median_insert(&h->dev, dev);
+    }
+    median_insert(&h->value, x);
+
+    return !(*outlier && h->drop);
+}
+
+/**
+ * @brief 指数滑动平均
+ */
+static int64_t ema_process(TDC_EmaTypeDef *e, int64_t x) {
+    int64_t x_q8 = x * 256;
+
+    if (!e->init) {
+        e->y_q8 = x_q8;
+        e->init = 1;
+    } else {
+        e->y_q8 += (x_q8 - e->y_q8) >> e->shift;
+    }
+    return (e->y_q8 + 128) >> 8;
+}
+
+/**
+ * @brief 一维卡尔曼：预测 P += Q，更新 K = P / (P + R)，x += K (z - x)，P = (1 - K) P
+ */
+static int64_t kalman_process(TDC_KalmanTypeDef *k, int64_t z) {
+    int64_t z_q8 = z * 256;
+    uint64_t gain_q16;
+
+    if (!k->init) {
+        k->x_q8 = z_q8;
+        k->p_q8 = k->r_q8;
+        k->init = 1;
+        return z;
+    }
+
+    k->p_q8 += k->q_q8;
+    gain_q16 = (k->p_q8 << 16) / (k->p_q8 + k->r_q8);
+    k->x_q8 += ((z_q8 - k->x_q8) * (int64_t)gain_q16) >> 16;
+    k->p_q8 = ((65536U - gain_q16) * k->p_q8) >> 16;
+    return (k->x_q8 + 128) >> 8;
+}
+
+/**
+ * @brief 清空一级的状态
+ */
+static void stage_reset(TDC_FilterStageTypeDef *s) {
+    switch (s->kind) {
+    case TDC_FILTER_MEDIAN:
+        median_init(&s->u.median, s->u.median.w);
+        break;
+
+    case TDC_FILTER_HAMPEL:
+        median_init(&s->u.hampel.value, s->u.hampel.value.w);
+        median_init(&s->u.hampel.dev, s->u.hampel.dev.w);
+        break;
+
+    case TDC_FILTER_EMA:
+        s->u.ema.init = 0;
+        break;
+
+    case TDC_FILTER_KALMAN:
+        s->u.kalman.init = 0;
+        break;
+    }
+}
+
+/**
+ * @brief 取出下一个空闲的级
+ */
+static TDC_FilterStageTypeDef *stage_new(TDC_FilterTypeDef *f, TDC_FilterKindTypeDef kind) {
+    TDC_FilterStageTypeDef *s;
+
+    if (f->count >= TDC_FILTER_MAX_STAGES)
+        return NULL;
+    s = &f->stage[f->count++];
+    s->kind = kind;
+    return s;
+}
+
+//----------------- 对外接口 -----------------
+
+/**
+ * @brief 初始化为空流水线
+ */
+void TDC_Filter_Init(TDC_FilterTypeDef *f) {
+    f->count = 0;
+    f->in = 0;
+    f->out = 0;
+    f->outliers = 0;
+}
+
+/**
+ * @brief 清空各级的状态，保留配置
+ */
+void TDC_Filter_Reset(TDC_FilterTypeDef *f) {
+    for (uint8_t i = 0; i < f->count; i++)
+        stage_reset(&f->stage[i]);
+    f->in = 0;
+    f->out = 0;
+    f->outliers = 0;
+}
+
+/**
+ * @brief 追加滑动中值
+ */
+HAL_StatusTypeDef TDC_Filter_Add_Median(TDC_FilterTypeDef *f, uint8_t w) {
+    TDC_FilterStageTypeDef *s;
+
+    if (w == 0 || w > TDC_FILTER_MAX_WIN || (s = stage_new(f, TDC_FILTER_MEDIAN)) == NULL)
+        return HAL_ERROR;
+    median_init(&s->u.median, w);
+    return HAL_OK;
+}
+
+/**
+ * @brief 追加Hampel离群值剔除
+ */
+HAL_StatusTypeDef TDC_Filter_Add_Hampel(TDC_FilterTypeDef *f, uint8_t w, uint32_t k_q8, uint8_t drop) {
+    TDC_FilterStageTypeDef *s;
+
+    if (w < 3 || w > TDC_FILTER_MAX_WIN || k_q8 == 0 || (s = stage_new(f, TDC_FILTER_HAMPEL)) == NULL)
+        return HAL_ERROR;
+    median_init(&s->u.hampel.value, w);
+    median_init(&s->u.hampel.dev, w);
+    s->u.hampel.k_q8 = k_q8;
+    s->u.hampel.drop = drop;
+    return HAL_OK;
+}
+
+/**
+ * @brief 追加指数滑动平均
+ */
+HAL_StatusTypeDef TDC_Filter_Add_EMA(TDC_FilterTypeDef *f, uint8_t shift) {
+    TDC_FilterStageTypeDef *s;
+
+    if (shift == 0 || shift > 16 || (s = stage_new(f, TDC_FILTER_EMA)) == NULL)
+        return HAL_ERROR;
+    s->u.ema.shift = shift;
+    s->u.ema.init = 0;
+    return HAL_OK;
+}
+
+/**
+ * @brief 追加一维卡尔曼跟踪
+ */
+HAL_StatusTypeDef TDC_Filter_Add_Kalman(TDC_FilterTypeDef *f, uint32_t q_ps2, uint32_t r_ps2) {
+    TDC_FilterStageTypeDef *s;
+
+    if (r_ps2 == 0 || (s = stage_new(f, TDC_FILTER_KALMAN)) == NULL)
+        return HAL_ERROR;
+    s->u.kalman.q_q8 = (uint64_t)q_ps2 << 8;
+    s->u.kalman.r_q8 = (uint64_t)r_ps2 << 8;
+    s->u.kalman.init = 0;
+    return HAL_OK;
+}
+
+/**
+ * @brief 处理一个样本，依次通过各级
+ */
+uint8_t TDC_Filter_Process(TDC_FilterTypeDef *f, int64_t in, int64_t *out) {
+    int64_t v = in;
+    uint8_t outlier;
+
+    f->in++;
+    for (uint8_t i = 0; i < f->count; i++) {
+        TDC_FilterStageTypeDef *s = &f->stage[i];
+
+        switch (s->kind) {
+        case TDC_FILTER_MEDIAN:
+            median_insert(&s->u.median, v);
+            v = median_get(&s->u.median);
+            break;
+
+        case TDC_FILTER_HAMPEL:
+            if (!hampel_process(&s->u.hampel, v, &v, &outlier)) {
+                f->outliers++;
+                return 0;
+            }
+            f->outliers += outlier;
+            break;
+
+        case TDC_FILTER_EMA:
+            v = ema_process(&s->u.ema, v);
+            break;
+
+        case TDC_FILTER_KALMAN:
+            v = kalman_process(&s->u.kalman, v);
+            break;
+        }
+    }
+
+    f->out++;
+    *out = v;
+    return 1;
+}
@@ -0,0 +1,392 @@
+/**
+ * @file    tdc_hybrid.c
+ * @brief   TIM2输入捕获粗计数与GP22细时间相结合的大量程测量实现
+ */
+#include "tdc_hybrid.h"
+#include "tdc_conv.h"
+#include "tdc_config.h"
+
+static TIM_HandleTypeDef htim_cap;         // TIM2，32位粗计数与捕获
+static TIM_HandleTypeDef htim_mark;        // TIM8，标记脉冲
+static uint32_t g_cap_clk = 0;             // TIM2计数时钟 (Hz)，校准后为实测值
+static uint32_t g_mark_clk = 0;            // TIM8计数时钟 (Hz)，校准后为实测值
+static uint32_t g_max_ticks = 0;           // 接受的最大粗计数，TDC_HYBRID_MAX_MS对应的TIM2时钟数
+static uint32_t g_mark_delay = 0;          // 标记脉冲延迟 D，TIM8时钟数
+static uint32_t g_mark_width = 0;          // 标记脉冲宽度，TIM8时钟数
+static int64_t g_mark_ps = 0;              // 捕获到标记脉冲的延迟 D * Ttim (ps)
+static int32_t g_clk_err_ppb = 0;          // 定时器时钟相对标称值的偏差 (ppb)
+static uint8_t g_clk_cal = 0;              // 定时器时钟已用GP22校准
+static int64_t g_offset_ps = 0;            // 零点偏差
+static volatile uint8_t g_done = 0;        // 有新结果
+static volatile HAL_StatusTypeDef g_status = HAL_OK;  // 新结果是否有效
+static TDC_HybridResultTypeDef g_res;      // 最近一次结果
+
+/**
+ * @brief 计算TIM2的计数时钟
+ * @note  APB1分频不为1时，定时器时钟是PCLK1的2倍
+ */
+static uint32_t TIM2_Clock(void) {
+    uint32_t clk = HAL_RCC_GetPCLK1Freq();
+
+    if ((RCC->D2CFGR & RCC_D2CFGR_D2PPRE1) != RCC_APB1_DIV1)
+        clk *= 2;
+    return clk;
+}
+
+/**
+ * @brief 计算TIM8的计数时钟
+ */
+static uint32_t TIM8_Clock(void) {
+    uint32_t clk = HAL_RCC_GetPCLK2Freq();
+
+    if ((RCC->D2CFGR & RCC_D2CFGR_D2PPRE2) != RCC_APB2_DIV1)
+        clk *= 2;
+    return clk;
+}
+
+/**
+ * @brief 按偏差修正标称时钟
+ * @note  TIM2和TIM8都由同一个PLL驱动，偏差相同
+ */
+static uint32_t clk_corrected(uint32_t nominal, int32_t err_ppb) {
+    return (uint32_t)((int64_t)nominal + ((int64_t)nominal * err_ppb) / 1000000000);
+}
+
+/**
+ * @brief 按当前时钟重新计算与时钟有关的量
+ */
+static void clk_update(void) {
+    uint64_t max = (uint64_t)g_cap_clk * TDC_HYBRID_MAX_MS / 1000U;
+
+    g_max_ticks = (max > 0xFFFFFFFFU) ? 0xFFFFFFFFU : (uint32_t)max;
+}
+
+/**
+ * @brief 定时器时钟数换算为皮秒 (四舍五入)
+ * @note  分成整秒、纳秒和余数三段计算，32位时钟数下中间结果不会溢出
+ */
+static int64_t ticks_to_ps(uint32_t ticks, uint32_t clk) {
+    uint64_t sec = ticks / clk;
+    uint64_t r = (uint64_t)(ticks % clk) * 1000000000U;
+
+    return (int64_t)(sec * 1000000000000ULL + r / clk * 1000U + ((r % clk) * 1000U + clk / 2) / clk);
+}
+
+/**
+ * @brief 配置引脚：PA0 TIM2_CH1 (STOP)，PA1 TIM2_CH2 (START)，PC6 TIM8_CH1 (标记)
+ */
+static void hybrid_gpio_init(void) {
+    GPIO_InitTypeDef GPIO_InitStruct = {0};
+
+    __HAL_RCC_GPIOA_CLK_ENABLE();
+    __HAL_RCC_GPIOC_CLK_ENABLE();
+
+    GPIO_InitStruct.Pin = GPIO_PIN_0 | GPIO_PIN_1;
+    GPIO_InitStruct.Mode = GPIO_MODE_AF_PP;
+    GPIO_InitStruct.Pull = GPIO_NOPULL;
+    GPIO_InitStruct.Speed = GPIO_SPEED_FREQ_VERY_HIGH;
+    GPIO_InitStruct.Alternate = GPIO_AF1_TIM2;
+    HAL_GPIO_Init(GPIOA, &GPIO_InitStruct);
+
+    GPIO_InitStruct.Pin = GPIO_PIN_6;
+    GPIO_InitStruct.Alternate = GPIO_AF3_TIM8;
+    HAL_GPIO_Init(GPIOC, &GPIO_InitStruct);
+}
+
+/**
+ * @brief 配置TIM2：32位自由运行，CH1、CH2上升沿捕获，CH1捕获时输出TRGO
+ */
+static HAL_StatusTypeDef cap_init(void) {
+    TIM_MasterConfigTypeDef sMasterConfig = {0};
+    TIM_IC_InitTypeDef sConfigIC = {0};
+
+    __HAL_RCC_TIM2_CLK_ENABLE();
+    htim_cap.Instance = TIM2;
+    htim_cap.Init.Prescaler = 0;
+    htim_cap.Init.CounterMode = TIM_COUNTERMODE_UP;
+    htim_cap.Init.Period = 0xFFFFFFFF;
+    htim_cap.Init.ClockDivision = TIM_CLOCKDIVISION_DIV1;
+    htim_cap.Init.AutoReloadPreload = TIM_AUTORELOAD_PRELOAD_DISABLE;
+    if (HAL_TIM_IC_Init(&htim_cap) != HAL_OK)
+        return HAL_ERROR;
+
+    sConfigIC.ICPolarity = TIM_INPUTCHANNELPOLARITY_RISING;
+    sConfigIC.ICSelection = TIM_ICSELECTION_DIRECTTI;
+    sConfigIC.ICPrescaler = TIM_ICPSC_DIV1;
+    sConfigIC.ICFilter = 0;  // 滤波会增加捕获延迟
+    if (HAL_TIM_IC_ConfigChannel(&htim_cap, &sConfigIC, TIM_CHANNEL_1) != HAL_OK ||
+        HAL_TIM_IC_ConfigChannel(&htim_cap, &sConfigIC, TIM_CHANNEL_2) != HAL_OK)
+        return HAL_ERROR;
+
+    // CH1捕获时TRGO输出一个脉冲，触发TIM8发出标记
+    sMasterConfig.MasterOutputTrigger = TIM_TRGO_OC1;
+    sMasterConfig.MasterSlaveMode = TIM_MASTERSLAVEMODE_DISABLE;
+    if (HAL_TIMEx_MasterConfigSynchronization(&htim_cap, &sMasterConfig) != HAL_OK)
+        return HAL_ERROR;
+
+    if (HAL_TIM_IC_Start(&htim_cap, TIM_CHANNEL_1) != HAL_OK ||
+        HAL_TIM_IC_Start(&htim_cap, TIM_CHANNEL_2) != HAL_OK)
+        return HAL_ERROR;
+    return HAL_OK;
+}
+
+/**
+ * @brief 配置TIM8：TIM2_TRGO触发的单脉冲，上升沿在触发后 D 个时钟
+ */
+static HAL_StatusTypeDef mark_init(void) {
+    TIM_OC_InitTypeDef sConfigOC = {0};
+    TIM_SlaveConfigTypeDef sSlaveConfig = {0};
+    uint32_t clk = g_mark_clk;
+    uint32_t delay = (uint32_t)(((uint64_t)TDC_HYBRID_MARKER_DELAY_NS * clk + 500000000U) / 1000000000U);
+    uint32_t width = (uint32_t)(((uint64_t)TDC_HYBRID_MARKER_WIDTH_NS * clk + 500000000U) / 1000000000U);
+
+    if (delay == 0 || width == 0 || delay + width > 65536)
+        return HAL_ERROR;
+
+    __HAL_RCC_TIM8_CLK_ENABLE();
+    htim_mark.Instance = TIM8;
+    htim_mark.Init.Prescaler = 0;
+    htim_mark.Init.CounterMode = TIM_COUNTERMODE_UP;
+    htim_mark.Init.Period = delay + width - 1;
+    htim_mark.Init.ClockDivision = TIM_CLOCKDIVISION_DIV1;
+    htim_mark.Init.RepetitionCounter = 0;
+    htim_mark.Init.AutoReloadPreload = TIM_AUTORELOAD_PRELOAD_DISABLE;
+    if (HAL_TIM_PWM_Init(&htim_mark) != HAL_OK ||
+        HAL_TIM_OnePulse_Init(&htim_mark, TIM_OPMODE_SINGLE) != HAL_OK)
+        return HAL_ERROR;
+
+    // PWM2：CNT >= CCR1 时输出高电平，与START脉冲发生器相同
+    sConfigOC.OCMode = TIM_OCMODE_PWM2;
+    sConfigOC.Pulse = delay;
+    sConfigOC.OCPolarity = TIM_OCPOLARITY_HIGH;
+    sConfigOC.OCNPolarity = TIM_OCNPOLARITY_HIGH;
+    sConfigOC.OCFastMode = TIM_OCFAST_DISABLE;
+    sConfigOC.OCIdleState = TIM_OCIDLESTATE_RESET;
+    sConfigOC.OCNIdleState = TIM_OCNIDLESTATE_RESET;
+    if (HAL_TIM_PWM_ConfigChannel(&htim_mark, &sConfigOC, TIM_CHANNEL_1) != HAL_OK)
+        return HAL_ERROR;
+
+    sSlaveConfig.SlaveMode = TIM_SLAVEMODE_TRIGGER;
+    sSlaveConfig.InputTrigger = TIM_TS_ITR1;  // TIM8的ITR1连接TIM2_TRGO
+    if (HAL_TIM_SlaveConfigSynchro(&htim_mark, &sSlaveConfig) != HAL_OK)
+        return HAL_ERROR;
+
+    TIM_CCxChannelCmd(htim_mark.Instance, TIM_CHANNEL_1, TIM_CCx_ENABLE);
+    __HAL_TIM_MOE_ENABLE(&htim_mark);
+    g_mark_delay = delay;
+    g_mark_width = width;
+    g_mark_ps = ticks_to_ps(delay, g_mark_clk);
+    return HAL_OK;
+}
+
+/**
+ * @brief 修改标记脉冲的延迟，宽度不变
+ * @note  只能在两次测量之间调用，TIM8此时已停止
+ */
+static void mark_set_delay(uint32_t delay) {
+    htim_mark.Instance->ARR = delay + g_mark_width - 1;
+    htim_mark.Instance->CCR1 = delay;
+    g_mark_delay = delay;
+    g_mark_ps = ticks_to_ps(delay, g_mark_clk);
+}
+
+/**
+ * @brief 清除两路捕获标志，丢弃之前的边沿
+ */
+static void cap_clear(void) {
+    (void)htim_cap.Instance->CCR1;
+    (void)htim_cap.Instance->CCR2;
+    htim_cap.Instance->SR = ~(uint32_t)(TIM_SR_CC1IF | TIM_SR_CC2IF | TIM_SR_CC1OF | TIM_SR_CC2OF);
+}
+
+/**
+ * @brief 细测量完成回调，运行在EXTI中断中
+ * @note  GP22的结果只在收到STOP1 (标记脉冲) 后产生，此时两路捕获都已完成
+ */
+static void hybrid_cplt(TDC_HandleTypeDef *htdc, const TDC_HitsTypeDef *hits) {
+    uint32_t sr = htim_cap.Instance->SR;
+    uint32_t stop = htim_cap.Instance->CCR1;
+    uint32_t start = htim_cap.Instance->CCR2;
+
+    g_status = HAL_ERROR;
+    if ((sr & (TIM_SR_CC1IF | TIM_SR_CC2IF)) == (TIM_SR_CC1IF | TIM_SR_CC2IF) &&
+        (sr & TIM_SR_CC1OF) == 0 && hits->count != 0 && stop - start <= g_max_ticks) {
+        g_res.coarse = stop - start;
+        g_res.fine_ps = TDC_Raw_to_ps(htdc, hits->raw[0]);
+        g_res.ps = ticks_to_ps(g_res.coarse, g_cap_clk) + g_mark_ps - g_res.fine_ps - g_offset_ps;
+        g_status = HAL_OK;
+    }
+    g_done = 1;
+}
+
+/**
+ * @brief 初始化混合测量
+ */
+HAL_StatusTypeDef TDC_Hybrid_Init(TDC_HandleTypeDef *htdc) {
+    HAL_StatusTypeDef ret;
+
+    if (TDC_Get_Range(htdc) != TDC_RANGE_1)
+        return HAL_ERROR;
+    ret = TDC_Set_Hits(htdc, 1, 0);
+    if (ret != HAL_OK)
+        return ret;
+
+    hybrid_gpio_init();
+    g_cap_clk = clk_corrected(TIM2_Clock(), g_clk_err_ppb);
+    g_mark_clk = clk_corrected(TIM8_Clock(), g_clk_err_ppb);
+    clk_update();
+    if (cap_init() != HAL_OK || mark_init() != HAL_OK)
+        return HAL_ERROR;
+
+    g_done = 0;
+    TDC_Register_Callbacks(htdc, NULL, hybrid_cplt);
+    return HAL_OK;
+}
+
+/**
+ * @brief 停止混合测量
+ */
+void TDC_Hybrid_DeInit(TDC_HandleTypeDef *htdc) {
+    TDC_Measure_Abort(htdc);
+    TDC_Register_Callbacks(htdc, NULL, NULL);
+    HAL_TIM_IC_Stop(&htim_cap, TIM_CHANNEL_1);
+    HAL_TIM_IC_Stop(&htim_cap, TIM_CHANNEL_2);
+    __HAL_TIM_MOE_DISABLE_UNCONDITIONALLY(&htim_mark);
+}
+
+/**
+ * @brief 设置零点偏差
+ */
+void TDC_Hybrid_Set_Offset(int64_t offset_ps) {
+    g_offset_ps = offset_ps;
+}
+
+/**
+ * @brief 启动一次混合测量
+ * @note  GP22先由 TDC_Measure_Start_IT() 发送Init，START脉冲只被TIM2捕获，GP22等待STOP事件
+ */
+HAL_StatusTypeDef TDC_Hybrid_Start_IT(TDC_HandleTypeDef *htdc) {
+    if (TDC_Is_Busy(htdc))
+        return HAL_BUSY;
+
+    g_done = 0;
+    cap_clear();
+    return TDC_Measure_Start_IT(htdc);
+}
+
+/**
+ * @brief 取出最近一次完成的混合测量结果
+ */
+HAL_StatusTypeDef TDC_Hybrid_Get_Result(TDC_HybridResultTypeDef *res) {
+    if (!g_done)
+        return HAL_BUSY;
+
+    *res = g_res;
+    g_done = 0;
+    return g_status;
+}
+
+/**
+ * @brief 进行一次混合测量 (阻塞方式)
+ */
+HAL_StatusTypeDef TDC_Hybrid_Measure(TDC_HandleTypeDef *htdc, TDC_HybridResultTypeDef *res, uint32_t timeout_us) {
+    DWT_DeadlineTypeDef dl;
+    HAL_StatusTypeDef ret;
+
+    if (TDC_Cal_Due(htdc))
+        TDC_Calibrate(htdc, TDC_CAL_TIMEOUT_US);
+    DWT_Deadline_us(&dl, timeout_us);
+    ret = TDC_Hybrid_Start_IT(htdc);
+    if (ret != HAL_OK)
+        return ret;
+
+    while ((ret = TDC_Hybrid_Get_Result(res)) == HAL_BUSY) {
+        if (DWT_Expired(&dl)) {
+            TDC_Measure_Abort(htdc);  // 没有STOP事件时GP22不会产生TDC_INT，下一次Init即可恢复
+            return HAL_TIMEOUT;
+        }
+    }
+    return ret;
+}
+
+/**
+ * @brief 在当前标记延迟下连续测量，求细时间的平均值
+ * @param mean_q4 细时间平均值，单位ps，Q4定点
+ * @return HAL_OK 成功；其他 失败次数达到n或测量出错
+ */
+static HAL_StatusTypeDef cal_mean(TDC_HandleTypeDef *htdc, uint32_t n, uint32_t timeout_us, int64_t *mean_q4) {
+    TDC_HybridResultTypeDef res;
+    HAL_StatusTypeDef ret;
+    int64_t sum = 0;
+    uint32_t ok = 0, fail = 0;
+
+    while (ok < n) {
+        ret = TDC_Hybrid_Measure(htdc, &res, timeout_us);
+        if (ret == HAL_OK) {
+            sum += res.fine_ps;
+            ok++;
+        } else if (ret == HAL_BUSY || ++fail >= n) {
+            return ret;
+        }
+    }
+    *mean_q4 = sum * 16 / (int64_t)n;
+    return HAL_OK;
+}
+
+/**
+ * @brief 用GP22校准定时器时钟
+ * @note  标记脉冲延迟增加span个TIM8时钟，细时间的平均值就增加 span * Ttim。
+ *        细时间以晶振校准后的Tref为基准，捕获同步延迟等固定部分在相减时抵消。
+ */
+HAL_StatusTypeDef TDC_Hybrid_Calibrate_Clock(TDC_HandleTypeDef *htdc, uint32_t n, uint32_t timeout_us) {
+    uint32_t d1 = g_mark_delay;
+    uint32_t span;
+    uint32_t nominal = TIM8_Clock();
+    int64_t m1, m2, err;
+    uint64_t clk;
+    HAL_StatusTypeDef ret;
+
+    span = (uint32_t)(((uint64_t)TDC_HYBRID_CAL_SPAN_NS * nominal + 500000000U) / 1000000000U);
+    if (n == 0 || d1 == 0 || span == 0 || d1 + span + g_mark_width > 65536)
+        return HAL_ERROR;
+
+    // 细时间必须以实测的Tref换算
+    ret = TDC_Calibrate(htdc, TDC_CAL_TIMEOUT_US);
+    if (ret != HAL_OK)
+        return ret;
+
+    ret = cal_mean(htdc, n, timeout_us, &m1);
+    if (ret == HAL_OK) {
+        mark_set_delay(d1 + span);
+        ret = cal_mean(htdc, n, timeout_us, &m2);
+        mark_set_delay(d1);
+    }
+    if (ret != HAL_OK)
+        return ret;
+    if (m2 <= m1)
+        return HAL_ERROR;
+
+    // span个TIM8时钟 = (m2 - m1) / 16 ps
+    clk = ((uint64_t)span * 16000000000000ULL + (uint64_t)(m2 - m1) / 2) / (uint64_t)(m2 - m1);
+    if (clk < nominal / 2 || clk > (uint64_t)nominal * 2)
+        return HAL_ERROR;
+    err = ((int64_t)clk - (int64_t)nominal) * 1000000000 / (int64_t)nominal;
+    if (err > (int64_t)TDC_HYBRID_CLK_TOL_PPM * 1000 || err < -(int64_t)TDC_HYBRID_CLK_TOL_PPM * 1000)
+        return HAL_ERROR;
+
+    g_clk_err_ppb = (int32_t)err;
+    g_clk_cal = 1;
+    g_mark_clk = (uint32_t)clk;
+    g_cap_clk = clk_corrected(TIM2_Clock(), g_clk_err_ppb);
+    clk_update();
+    mark_set_delay(d1);  // 按实测时钟重新计算标记延迟
+    return HAL_OK;
+}
+
+/**
+ * @brief 获取定时器时钟相对标称值的偏差
+ */
+HAL_StatusTypeDef TDC_Hybrid_Get_Clock_Error(int32_t *err_ppb) {
+    *err_ppb = g_clk_err_ppb;
+    return g_clk_cal ? HAL_OK : HAL_ERROR;
+}
@@ -0,0 +1,317 @@
+/**
+ * @file    tdc_io.c
+ * @brief   GP22 TDC底层总线驱动实现
+ * @details 提供软件模拟SPI和硬件SPI两个后端，DMA模拟SPI后端在 tdc_bbdma.c 中。GP22工作在SPI模式1：
+ *          时钟空闲为低，上升沿输出数据，下降沿采样数据。
+ *          SCK/SI/SO为所有芯片共用，SSN和SPI句柄取自各自的句柄。
+ */
+#include "tdc_io.h"
+#include "tdc.h"
+#include "tdc_bbdma.h"
+
+/**
+ * @brief GPIO控制宏定义，直接写BSRR，避免HAL函数调用的开销
+ */
+#define SSN(h, x) ((h)->ssn_port->BSRR = (x) ? (h)->ssn_pin : (uint32_t)(h)->ssn_pin << 16U)
+#define SCK(x) (TDC_SCK_GPIO_Port->BSRR = (x) ? TDC_SCK_Pin : (uint32_t)TDC_SCK_Pin << 16U)
+#define SI(x)  (TDC_SI_GPIO_Port->BSRR = (x) ? TDC_SI_Pin : (uint32_t)TDC_SI_Pin << 16U)
+
+/**
+ * @brief GPIO读取宏定义
+ */
+#define SO()   ((TDC_SO_GPIO_Port->IDR & TDC_SO_Pin) != 0)
+
+//----------------- 软件模拟SPI后端 -----------------
+
+/**
+ * @brief 发送一位
+ * @note SCK低电平期间准备好SI，上升沿之后保持，GP22在下降沿采样
+ */
+static inline void send_bit(uint8_t bit) {
+    SI(bit);
+    SCK(1);
+    DWT_Delay_ns(TDC_T_SCK_HIGH_NS);
+    SCK(0);
+    DWT_Delay_ns(TDC_T_SCK_LOW_NS);
+}
+
+/**
+ * @brief 按位发送一个字节，高位在前
+ */
+static void bitbang_write8(uint8_t wbuf8) {
+    uint8_t MSB8 = 0x80;
+
+    for (uint8_t cnt = 8; cnt > 0; cnt--) {
+        send_bit((wbuf8 & MSB8) > 0);
+        MSB8 /= 2;
+    }
+}
+
+/**
+ * @brief 按位读取一个字节，高位在前
+ */
+static uint8_t bitbang_read8(void) {
+    uint8_t LSB8 = 0x80;
+    uint8_t rbuf8 = 0x00;
+
+    for (uint8_t cnt = 8; cnt > 0; cnt--) {
+        SCK(1);
+        DWT_Delay_ns(TDC_T_SCK_HIGH_NS > TDC_T_SO_VALID_NS ? TDC_T_SCK_HIGH_NS : TDC_T_SO_VALID_NS);
+        if (SO())
+            rbuf8 |= LSB8;
+        LSB8 /= 2;
+        SCK(0);
+        DWT_Delay_ns(TDC_T_SCK_LOW_NS);
+    }
+    return rbuf8;
+}
+
+/**
+ * @brief 软件模拟SPI的一次片选事务
+ */
+static void bitbang_transfer(TDC_HandleTypeDef *htdc, uint8_t opcode, const uint8_t *tx, uint8_t *rx, uint8_t len) {
+    SSN(htdc, 0);
+    DWT_Delay_ns(TDC_T_SSN_SETUP_NS);
+    bitbang_write8(opcode);
+    for (uint8_t i = 0; i < len; i++) {
+        if (rx != NULL)
+            rx[i] = bitbang_read8();
+        else
+            bitbang_write8(tx[i]);
+    }
+    DWT_Delay_ns(TDC_T_SSN_HOLD_NS);
+    SSN(htdc, 1);
+    DWT_Delay_ns(TDC_T_SSN_HIGH_NS);
+}
+
+static const TDC_IO_OpsTypeDef bitbang_ops = {
+    .name = "bitbang",
+    .transfer = bitbang_transfer,
+};
+
+//----------------- 硬件SPI后端 -----------------
+
+/**
+ * @brief 直接操作寄存器完成n个字节的全双工传输
+ * @return 1 完成；0 超时，传输已被中止
+ * @note  在关中断下调用，不能使用依赖HAL_GetTick的 HAL_SPI_TransmitReceive()，用DWT计时。
+ *        与HAL一样每次传输结束时关闭SPE，HAL句柄的状态不受影响。
+ */
+static uint8_t spi_xfer(SPI_TypeDef *spi, const uint8_t *tx, uint8_t *rx, uint8_t n) {
+    DWT_DeadlineTypeDef dl;
+    uint8_t ti = 0, ri = 0;
+
+    CLEAR_BIT(spi->CR1, SPI_CR1_SPE);
+    MODIFY_REG(spi->CFG1, SPI_CFG1_FTHLV, 0);  // 每收到1个字节置位RXP
+    MODIFY_REG(spi->CR2, SPI_CR2_TSIZE, n);
+    SET_BIT(spi->CR1, SPI_CR1_SPE);
+    SET_BIT(spi->CR1, SPI_CR1_CSTART);
+
+    DWT_Deadline_us(&dl, TDC_SPI_TIMEOUT_US);
+    while (ri < n || !(spi->SR & SPI_SR_EOT)) {
+        if (ti < n && (spi->SR & SPI_SR_TXP))
+            *(__IO uint8_t *)&spi->TXDR = tx[ti++];  // 按字节访问，FIFO中只放入一帧
+        if (ri < n && (spi->SR & SPI_SR_RXP))
+            rx[ri++] = *(__IO uint8_t *)&spi->RXDR;
+        if (DWT_Expired(&dl))
+            break;
+    }
+
+    // 超时时先挂起传输，挂起也不能完成时直接关闭SPE
+    if (spi->CR1 & SPI_CR1_CSTART) {
+        SET_BIT(spi->CR1, SPI_CR1_CSUSP);
+        DWT_Deadline_us(&dl, 1);
+        while ((spi->CR1 & SPI_CR1_CSTART) && !DWT_Expired(&dl)) {
+        }
+    }
+    CLEAR_BIT(spi->CR1, SPI_CR1_SPE);
+    spi->IFCR = 0xFFFFFFFFU;
+    return ri == n;
+}
+
+/**
+ * @brief 硬件SPI的一次片选事务，操作码和数据在同一次传输中发出
+ * @note  传输失败时计入 io_timeout，读回的数据全部置0，不返回未初始化的缓冲区
+ */
+static void spi_transfer(TDC_HandleTypeDef *htdc, uint8_t opcode, const uint8_t *tx, uint8_t *rx, uint8_t len) {
+    uint8_t txbuf[1 + TDC_IO_MAX_PAYLOAD];
+    uint8_t rxbuf[1 + TDC_IO_MAX_PAYLOAD];
+    uint8_t ok;
+
+    txbuf[0] = opcode;
+    for (uint8_t i = 0; i < len; i++) {
+        txbuf[1 + i] = (tx != NULL) ? tx[i] : 0xFF;  // 读取时发送的空数据
+    }
+
+    SSN(htdc, 0);
+    ok = spi_xfer(htdc->hspi->Instance, txbuf, rxbuf, 1 + len);
+    SSN(htdc, 1);
+    DWT_Delay_ns(TDC_T_SSN_HIGH_NS);
+
+    if (!ok)
+        htdc->err.io_timeout++;
+    if (rx != NULL) {
+        for (uint8_t i = 0; i < len; i++) {
+            rx[i] = ok ? rxbuf[1 + i] : 0;
+        }
+    }
+}
+
+static const TDC_IO_OpsTypeDef spi_ops = {
+    .name = "spi",
+    .transfer = spi_transfer,
+};
+
+//----------------- 对外接口 -----------------
+
+/**
+ * @brief 初始化TDC总线，选择编译期默认后端
+ * @param htdc TDC句柄，使用其中的SPI句柄 (可以为NULL) 和SSN引脚
+ */
+void TDC_IO_Init(TDC_HandleTypeDef *htdc) {
+    htdc->ops = &bitbang_ops;
+    SSN(htdc, 1);
+    SCK(0);
+
+    TDC_IO_Set_Transport(htdc, TDC_TRANSPORT_DEFAULT);  // 失败时保持软件SPI
+}
+
+/**
+ * @brief 运行时切换总线后端
+ * @param transport 目标后端
+ * @return HAL_OK 切换成功；HAL_ERROR 后端不可用
+ */
+HAL_StatusTypeDef TDC_IO_Set_Transport(TDC_HandleTypeDef *htdc, TDC_TransportTypeDef transport) {
+    switch (transport) {
+    case TDC_TRANSPORT_BITBANG:
+        htdc->ops = &bitbang_ops;
+        return HAL_OK;
+
+    case TDC_TRANSPORT_SPI:
+        // GP22只支持SPI模式1，且片选由本驱动控制；传输按字节访问FIFO
+        if (htdc->hspi == NULL ||
+            htdc->hspi->Init.Mode != SPI_MODE_MASTER ||
+            htdc->hspi->Init.DataSize != SPI_DATASIZE_8BIT ||
+            htdc->hspi->Init.CLKPolarity != SPI_POLARITY_LOW ||
+            htdc->hspi->Init.CLKPhase != SPI_PHASE_2EDGE ||
+            htdc->hspi->Init.NSS != SPI_NSS_SOFT) {
+            return HAL_ERROR;
+        }
+        htdc->ops = &spi_ops;
+        return HAL_OK;
+
+    case TDC_TRANSPORT_DMA:
+        if (TDC_BBDMA_Init() != HAL_OK)
+            return HAL_ERROR;
+        htdc->ops = TDC_BBDMA_Ops();
+        return HAL_OK;
+
+    default:
+        return HAL_ERROR;
+    }
+}
+
+/**
+ * @brief 获取当前使用的总线后端
+ */
+TDC_TransportTypeDef TDC_IO_Get_Transport(TDC_HandleTypeDef *htdc) {
+    if (htdc->ops == &spi_ops)
+        return TDC_TRANSPORT_SPI;
+    if (htdc->ops == TDC_BBDMA_Ops())
+        return TDC_TRANSPORT_DMA;
+    return TDC_TRANSPORT_BITBANG;
+}
+
+/**
+ * @brief 完成一次片选事务：操作码 + len字节数据
+ * @note  共用总线上的事务不能被另一片芯片的中断打断，整个事务在关中断下完成。
+ *        因此后端都不能依赖SysTick计时，总线卡住时用DWT超时返回并计入 io_timeout
+ */
+void TDC_IO_Transfer(TDC_HandleTypeDef *htdc, uint8_t opcode, const uint8_t *tx, uint8_t *rx, uint8_t len) {
+    uint32_t primask;
+
+    if (len > TDC_IO_MAX_PAYLOAD)
+        len = TDC_IO_MAX_PAYLOAD;
+    if (htdc->ops == NULL)
+        htdc->ops = &bitbang_ops;
+
+    primask = __get_PRIMASK();
+    __disable_irq();
+    htdc->ops->transfer(htdc, opcode, tx, rx, len);
+    __set_PRIMASK(primask);
+}
+
+/**
+ * @brief 发送单字节操作码
+ */
+void TDC_IO_Write8(TDC_HandleTypeDef *htdc, uint8_t opcode) {
+    TDC_IO_Transfer(htdc, opcode, NULL, NULL, 0);
+}
+
+/**
+ * @brief 写入32位字，最高字节为操作码，低24位为寄存器数据
+ */
+void TDC_IO_Write32(TDC_HandleTypeDef *htdc, uint32_t word) {
+    uint8_t data[3];
+
+    data[0] = (word >> 16) & 0xFF;
+    data[1] = (word >> 8) & 0xFF;
+    data[2] = word & 0xFF;
+    TDC_IO_Transfer(htdc, (word >> 24) & 0xFF, data, NULL, 3);
+}
+
+/**
+ * @brief 发送读操作码并读回8位数据
+ */
+uint8_t TDC_IO_Read8(TDC_HandleTypeDef *htdc, uint8_t opcode) {
+    uint8_t data;
+
+    TDC_IO_Transfer(htdc, opcode, NULL, &data, 1);
+    return data;
+}
+
+/**
+ * @brief 发送读操作码并读回16位数据
+ */
+uint16_t TDC_IO_Read16(TDC_HandleTypeDef *htdc, uint8_t opcode) {
+    uint8_t data[2];
+
+    TDC_IO_Transfer(htdc, opcode, NULL, data, 2);
+    return ((uint16_t)data[0] << 8) | data[1];
+}
+
+/**
+ * @brief 发送读操作码并读回32位数据
+ */
+uint32_t TDC_IO_Read32(TDC_HandleTypeDef *htdc, uint8_t opcode) {
+    uint8_t data[4];
+
+    TDC_IO_Transfer(htdc, opcode, NULL, data, 4);
+    return ((uint32_t)data[0] << 24) |
+           ((uint32_t)data[1] << 16) |
+           ((uint32_t)data[2] << 8) |
+           data[3];
+}
+
+/**
+ * @brief 测量某个总线后端读取一个32位寄存器的平均耗时
+ * @param transport 要测试的后端，测试后恢复原来的后端
+ * @param n 传输次数
+ * @return 每次传输的平均耗时，单位纳秒；后端不可用时返回0
+ */
+uint32_t TDC_IO_Benchmark(TDC_HandleTypeDef *htdc, TDC_TransportTypeDef transport, uint32_t n) {
+    const TDC_IO_OpsTypeDef *saved = htdc->ops;
+    uint32_t t;
+
+    if (n == 0 || TDC_IO_Set_Transport(htdc, transport) != HAL_OK)
+        return 0;
+
+    t = DWT_Cycles();
+    for (uint32_t i = 0; i < n; i++) {
+        (void)TDC_IO_Read32(htdc, 0xB4);  // 读状态寄存器，对芯片没有副作用
+    }
+    t = DWT_Cycles() - t;
+
+    htdc->ops = saved;
+    return DWT_cycles_to_ns(t / n);
+}
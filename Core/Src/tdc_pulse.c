@@ -0,0 +1,181 @@
+/**
+ * @file    tdc_pulse.c
+ * @brief   TIM1_CH3 (PA10) 硬件定时START脉冲实现
+ * @details TIM1工作在PWM2 + 单脉冲模式：计数器从0数到ARR，CNT >= CCR3 时输出高电平。
+ *          上升沿位于 CCR3，脉冲宽度为 ARR - CCR3 + 1 个时钟。
+ *          重复计数器 RCR = N-1 时，计数器停止前连续输出N个脉冲。
+ */
+#include "tdc_pulse.h"
+#include "tim.h"
+#include "tdc_config.h"
+
+static uint32_t g_clk = 0;     // TIM1计数时钟 (Hz)
+static uint32_t g_width = 0;   // 脉冲宽度 (时钟数)
+static uint32_t g_period = 0;  // 脉冲串周期 (时钟数)
+static int32_t g_clk_err_ppb = 0; // TIM1时钟相对标称值的偏差 (ppb)
+static uint8_t g_clk_cal = 0;     // g_clk_err_ppb 已经校准
+
+/**
+ * @brief 计算TIM1的计数时钟
+ * @note  APB2分频不为1时，定时器时钟是PCLK2的2倍
+ */
+static uint32_t TIM1_Clock(void) {
+    uint32_t clk = HAL_RCC_GetPCLK2Freq();
+
+    if ((RCC->D2CFGR & RCC_D2CFGR_D2PPRE2) != RCC_APB2_DIV1)
+        clk *= 2;
+    return clk;
+}
+
+/**
+ * @brief 按校准偏差修正后的TIM1时钟 (Hz)
+ */
+static uint64_t clk_actual(void) {
+    return (uint64_t)((int64_t)g_clk + ((int64_t)g_clk * g_clk_err_ppb) / 1000000000);
+}
+
+/**
+ * @brief 计数器是否在运行，即一串脉冲正在输出
+ */
+static uint8_t pulse_running(void) {
+    return (htim1.Instance->CR1 & TIM_CR1_CEN) != 0;
+}
+
+/**
+ * @brief 纳秒换算为TIM1时钟数 (四舍五入)
+ */
+static uint32_t ns_to_ticks(uint32_t ns) {
+    return (uint32_t)(((uint64_t)ns * g_clk + 500000000U) / 1000000000U);
+}
+
+/**
+ * @brief 初始化START脉冲发生器
+ */
+HAL_StatusTypeDef TDC_Pulse_Init(void) {
+    g_clk = TIM1_Clock();
+
+    if (TDC_Pulse_Set_Trigger(TDC_PULSE_TRIG_SOFTWARE) != HAL_OK)
+        return HAL_ERROR;
+    if (TDC_Pulse_Config(TDC_START_WIDTH_NS, TDC_START_PERIOD_NS) != HAL_OK)
+        return HAL_ERROR;
+
+    // 只打开通道输出，不启动计数器
+    TIM_CCxChannelCmd(htim1.Instance, TIM_CHANNEL_3, TIM_CCx_ENABLE);
+    __HAL_TIM_MOE_ENABLE(&htim1);
+    return HAL_OK;
+}
+
+/**
+ * @brief 设置脉冲宽度和脉冲串周期
+ */
+HAL_StatusTypeDef TDC_Pulse_Config(uint32_t width_ns, uint32_t period_ns) {
+    uint32_t width = ns_to_ticks(width_ns);
+    uint32_t period = ns_to_ticks(period_ns);
+
+    if (TDC_Pulse_Is_Busy())
+        return HAL_BUSY;
+    if (width == 0 || period <= width || period > 65536)
+        return HAL_ERROR;
+
+    g_width = width;
+    g_period = period;
+    __HAL_TIM_SET_AUTORELOAD(&htim1, period - 1);
+    __HAL_TIM_SET_COMPARE(&htim1, TIM_CHANNEL_3, period - width);
+    return HAL_OK;
+}
+
+/**
+ * @brief 推迟脉冲上升沿
+ * @note  CCR3和ARR同时增加，宽度不变，脉冲串的周期同样变长
+ */
+HAL_StatusTypeDef TDC_Pulse_Set_Delay(uint32_t ticks) {
+    if (TDC_Pulse_Is_Busy())
+        return HAL_BUSY;
+    if (g_period == 0 || g_period + ticks > 65536)
+        return HAL_ERROR;
+
+    __HAL_TIM_SET_AUTORELOAD(&htim1, g_period + ticks - 1);
+    __HAL_TIM_SET_COMPARE(&htim1, TIM_CHANNEL_3, g_period - g_width + ticks);
+    return HAL_OK;
+}
+
+/**
+ * @brief 选择触发源
+ * @note  TIM4触发模式下 TDC_Pulse_Is_Busy() 一直为1，这里只在脉冲输出期间拒绝，
+ *        否则无法退出TIM4触发模式
+ */
+HAL_StatusTypeDef TDC_Pulse_Set_Trigger(TDC_PulseTrigTypeDef trig) {
+    TIM_SlaveConfigTypeDef sSlaveConfig = {0};
+
+    if (pulse_running())
+        return HAL_BUSY;
+
+    if (trig == TDC_PULSE_TRIG_TIM4) {
+        sSlaveConfig.SlaveMode = TIM_SLAVEMODE_TRIGGER;
+        sSlaveConfig.InputTrigger = TIM_TS_ITR3;  // TIM1的ITR3连接TIM4_TRGO
+    } else {
+        sSlaveConfig.SlaveMode = TIM_SLAVEMODE_DISABLE;
+        sSlaveConfig.InputTrigger = TIM_TS_ITR0;
+    }
+    return HAL_TIM_SlaveConfigSynchro(&htim1, &sSlaveConfig);
+}
+
+/**
+ * @brief 发出一个脉冲或一串脉冲
+ */
+HAL_StatusTypeDef TDC_Pulse_Fire(uint32_t count) {
+    if (count == 0 || count > 65536)
+        return HAL_ERROR;
+    if (pulse_running())
+        return HAL_BUSY;
+
+    htim1.Instance->RCR = count - 1;
+    htim1.Instance->EGR = TIM_EGR_UG;  // 装载RCR并把计数器清零，输出保持低电平
+
+    // 触发模式下由TIM4_TRGO置位CEN，软件触发则立即启动
+    if ((htim1.Instance->SMCR & TIM_SMCR_SMS) != TIM_SLAVEMODE_TRIGGER)
+        htim1.Instance->CR1 |= TIM_CR1_CEN;
+    return HAL_OK;
+}
+
+/**
+ * @brief 查询脉冲是否正在输出或等待触发
+ * @note  单脉冲模式下每串脉冲结束后CEN清零，TIM4触发模式的下一个TRGO又会置位CEN，
+ *        等待触发时CEN为0，因此触发模式本身就算作忙
+ */
+uint8_t TDC_Pulse_Is_Busy(void) {
+    return pulse_running() || (htim1.Instance->SMCR & TIM_SMCR_SMS) == TIM_SLAVEMODE_TRIGGER;
+}
+
+/**
+ * @brief 设置TIM1时钟相对标称值的偏差
+ */
+void TDC_Pulse_Set_Clock_Error(int32_t err_ppb) {
+    g_clk_err_ppb = err_ppb;
+    g_clk_cal = 1;
+}
+
+/**
+ * @brief 查询TIM1时钟是否已经校准
+ */
+uint8_t TDC_Pulse_Clock_Is_Calibrated(void) {
+    return g_clk_cal;
+}
+
+/**
+ * @brief TIM1一个计数时钟对应的皮秒数
+ */
+uint32_t TDC_Pulse_Tick_ps(void) {
+    uint64_t clk = clk_actual();
+
+    return (clk != 0) ? (uint32_t)(1000000000000ULL / clk) : 0;
+}
+
+/**
+ * @brief TIM1一个计数时钟对应的飞秒数
+ */
+uint32_t TDC_Pulse_Tick_fs(void) {
+    uint64_t clk = clk_actual();
+
+    return (clk != 0) ? (uint32_t)(1000000000000000ULL / clk) : 0;
+}
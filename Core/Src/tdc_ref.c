@@ -0,0 +1,65 @@
+/**
+ * @file    tdc_ref.c
+ * @brief   STOP2参考通道的漂移补偿实现
+ */
+#include "tdc_ref.h"
+#include "tdc_conv.h"
+
+/**
+ * @brief 初始化参考通道补偿
+ */
+void TDC_Ref_Init(TDC_RefTypeDef *ref, int64_t ref_ps, uint8_t shift) {
+    ref->auto_ref = (ref_ps == TDC_REF_AUTO);
+    ref->ref_ps = ref->auto_ref ? 0 : ref_ps;
+    ref->shift = shift > 16 ? 16 : shift;
+    TDC_Ref_Reset(ref);
+}
+
+/**
+ * @brief 清除漂移估计
+ */
+void TDC_Ref_Reset(TDC_RefTypeDef *ref) {
+    if (ref->auto_ref)
+        ref->ref_ps = 0;  // 重新学习基准
+    ref->drift_q8 = 0;
+    ref->init = 0;
+    ref->count = 0;
+    ref->missing = 0;
+}
+
+/**
+ * @brief 换算并扣除参考通道漂移
+ * @note  STOP1收到的脉冲数决定STOP2第一个结果的位置
+ */
+uint8_t TDC_Ref_Correct(TDC_RefTypeDef *ref, TDC_HandleTypeDef *htdc, const TDC_HitsTypeDef *hits, int64_t *ps) {
+    TDC_ScaleTypeDef scale;
+    uint8_t n1 = TDC_Hits_Stop1_Count(htdc, hits);
+    int64_t drift_q8;
+
+    if (n1 == 0)
+        return 0;
+
+    TDC_Get_Scale(htdc, &scale);
+    *ps = TDC_Fixed_to_ps(hits->raw[0], &scale);
+
+    if (htdc->cfg.reg1.hitin2 != 0 && hits->count > n1) {
+        int64_t meas = TDC_Fixed_to_ps(hits->raw[n1], &scale);
+
+        if (!ref->init && ref->auto_ref)
+            ref->ref_ps = meas;  // 以清除后第一次测得的值为基准
+        drift_q8 = (meas - ref->ref_ps) * 256;
+        if (!ref->init || ref->shift == 0)
+            ref->drift_q8 = drift_q8;
+        else
+            ref->drift_q8 += (drift_q8 - ref->drift_q8) >> ref->shift;
+        ref->init = 1;
+        ref->count++;
+    } else {
+        ref->missing++;
+    }
+
+    if (!ref->init)
+        return 0;
+    *ps -= TDC_Ref_Get_Drift(ref);
+    return 1;
+}
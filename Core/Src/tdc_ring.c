@@ -0,0 +1,49 @@
+/**
+ * @file    tdc_ring.c
+ * @brief   TDC测量记录的单生产者/单消费者无锁环形缓冲区实现
+ * @details head/tail 为自由增长的32位计数，取模得到下标，回绕不影响 head - tail。
+ *          写数据和发布索引之间用 __DMB() 保证顺序。
+ */
+#include "tdc_ring.h"
+
+/**
+ * @brief 清空环形缓冲区
+ */
+void TDC_Ring_Reset(TDC_RingTypeDef *ring) {
+    ring->head = 0;
+    ring->tail = 0;
+    ring->overrun = 0;
+}
+
+/**
+ * @brief 写入一条记录 (生产者)
+ */
+uint8_t TDC_Ring_Push(TDC_RingTypeDef *ring, const TDC_RecordTypeDef *rec) {
+    uint32_t head = ring->head;
+
+    if (head - ring->tail >= TDC_RING_SIZE) {
+        ring->overrun++;
+        return 0;
+    }
+
+    ring->buf[head & (TDC_RING_SIZE - 1)] = *rec;
+    __DMB();  // 记录写完之后再发布
+    ring->head = head + 1;
+    return 1;
+}
+
+/**
+ * @brief 取出一条记录 (消费者)
+ */
+uint8_t TDC_Ring_Pop(TDC_RingTypeDef *ring, TDC_RecordTypeDef *rec) {
+    uint32_t tail = ring->tail;
+
+    if (ring->head == tail)
+        return 0;
+
+    __DMB();  // 先看到head，再读记录
+    *rec = ring->buf[tail & (TDC_RING_SIZE - 1)];
+    __DMB();  // 记录读完之后再释放槽位
+    ring->tail = tail + 1;
+    return 1;
+}
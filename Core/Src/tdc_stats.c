@@ -0,0 +1,151 @@
+/**
+ * @file    tdc_stats.c
+ * @brief   TDC测量结果的流式统计实现
+ * @details 更新公式 (x为Q16)：
+ *          d1 = x - mean;  mean += d1 / n;  d2 = x - mean;  M2 += d1 * d2
+ *          d1、d2先右移12位到Q4再相乘，得到Q8的M2，差值在±2^27 ps以内都不会溢出。
+ */
+#include "tdc_stats.h"
+
+/**
+ * @brief 清零一个累加器
+ * @note  其余成员在第一个样本到来时重新赋值
+ */
+void TDC_Welford_Reset(TDC_WelfordTypeDef *w) {
+    w->n = 0;
+}
+
+/**
+ * @brief 累加器加入一个样本
+ */
+void TDC_Welford_Add(TDC_WelfordTypeDef *w, int64_t ps) {
+    int64_t x = ps * 65536;
+    int64_t d1, d2;
+
+    if (w->n == 0) {
+        w->n = 1;
+        w->mean_q16 = x;
+        w->m2_q8 = 0;
+        w->min = ps;
+        w->max = ps;
+        return;
+    }
+
+    w->n++;
+    d1 = x - w->mean_q16;
+    w->mean_q16 += d1 / (int64_t)w->n;
+    d2 = x - w->mean_q16;
+    d1 = (d1 >> 12) * (d2 >> 12);
+    if (d1 > 0)
+        w->m2_q8 += (uint64_t)d1;
+
+    if (ps < w->min)
+        w->min = ps;
+    if (ps > w->max)
+        w->max = ps;
+}
+
+/**
+ * @brief 64位整数平方根 (向下取整)
+ */
+static uint32_t isqrt64(uint64_t v) {
+    uint64_t res = 0;
+    uint64_t bit = 1ULL << 62;
+
+    while (bit > v)
+        bit >>= 2;
+    while (bit != 0) {
+        if (v >= res + bit) {
+            v -= res + bit;
+            res = (res >> 1) + bit;
+        } else {
+            res >>= 1;
+        }
+        bit >>= 2;
+    }
+    return (uint32_t)res;
+}
+
+/**
+ * @brief 初始化统计对象
+ */
+void TDC_Stats_Init(TDC_StatsTypeDef *st, uint32_t window) {
+    st->window = window;
+    st->seq = 0;
+    TDC_Stats_Reset(st);
+}
+
+/**
+ * @brief 清零累计和窗口统计
+ * @note  生产者在中断里运行，这里关中断保证清零不被打断
+ */
+void TDC_Stats_Reset(TDC_StatsTypeDef *st) {
+    uint32_t primask = __get_PRIMASK();
+
+    __disable_irq();
+    st->seq++;
+    TDC_Welford_Reset(&st->life);
+    TDC_Welford_Reset(&st->win);
+    TDC_Welford_Reset(&st->last_win);
+    st->windows = 0;
+    st->seq++;
+    __set_PRIMASK(primask);
+}
+
+/**
+ * @brief 加入一个样本
+ */
+void TDC_Stats_Add(TDC_StatsTypeDef *st, int64_t ps) {
+    st->seq++;
+    __DMB();  // 先标记为正在更新，再改数据
+
+    TDC_Welford_Add(&st->life, ps);
+    TDC_Welford_Add(&st->win, ps);
+    if (st->window != 0 && st->win.n >= st->window) {
+        st->last_win = st->win;
+        st->windows++;
+        TDC_Welford_Reset(&st->win);
+    }
+
+    __DMB();  // 数据写完之后再结束更新
+    st->seq++;
+}
+
+/**
+ * @brief 取得一致的快照
+ * @note  拷贝期间如果生产者更新过 (序号变化或为奇数) 就重新拷贝
+ */
+void TDC_Stats_Snapshot(const TDC_StatsTypeDef *st, TDC_StatsSnapshotTypeDef *snap) {
+    uint32_t seq;
+
+    do {
+        seq = st->seq;
+        __DMB();
+        snap->life = st->life;
+        snap->win = st->win;
+        snap->last_win = st->last_win;
+        snap->windows = st->windows;
+        __DMB();
+    } while ((seq & 1) || seq != st->seq);
+}
+
+/**
+ * @brief 由累加器计算均值、标准差等结果
+ */
+void TDC_Welford_Result(const TDC_WelfordTypeDef *w, TDC_StatsResultTypeDef *res) {
+    res->n = w->n;
+    if (w->n == 0) {
+        res->mean_q4 = 0;
+        res->std_q4 = 0;
+        res->sem_q4 = 0;
+        res->min = 0;
+        res->max = 0;
+        return;
+    }
+
+    res->mean_q4 = (w->mean_q16 + 0x800) >> 12;
+    res->std_q4 = (w->n > 1) ? isqrt64(w->m2_q8 / (w->n - 1)) : 0;  // Q8的平方根为Q4
+    res->sem_q4 = (w->n > 1) ? isqrt64(w->m2_q8 / ((uint64_t)w->n * (w->n - 1))) : 0;
+    res->min = w->min;
+    res->max = w->max;
+}
@@ -0,0 +1,272 @@
+/**
+ * @file    tdc_stream.c
+ * @brief   测量记录的USART二进制遥测流实现
+ * @details 记录先装入未编码的帧缓冲区，装满或超时后加CRC、做COBS编码，写入空闲的发送缓冲区。
+ *          发送缓冲区的状态只有三种：空闲 -> 待发送 (主循环) -> 发送中 (启动DMA) -> 空闲 (DMA中断)。
+ *          同一时刻最多一个缓冲区在发送，DMA完成中断直接启动待发送的另一个。
+ */
+#include "tdc_stream.h"
+#include "dwt.h"
+
+#if TDC_STREAM_BATCH == 0 || TDC_STREAM_BATCH > 255
+#error "TDC_STREAM_BATCH must be between 1 and 255"
+#endif
+
+#define FRAME_RAW_MAX (TDC_STREAM_HEADER_SIZE + TDC_STREAM_RECORD_SIZE * TDC_STREAM_BATCH + TDC_STREAM_CRC_SIZE)
+#define FRAME_ENC_MAX (FRAME_RAW_MAX + FRAME_RAW_MAX / 254 + 2)  // COBS最大开销加结束符
+
+#define BUF_FREE  0
+#define BUF_READY 1
+#define BUF_BUSY  2
+
+static DMA_HandleTypeDef hdma_tx;          // DMA1 Stream6，USART1发送
+static TDC_HandleTypeDef *g_htdc = NULL;
+static UART_HandleTypeDef *g_huart = NULL;
+
+static uint8_t g_raw[FRAME_RAW_MAX];       // 正在装入的帧 (编码前)
+static uint8_t g_n = 0;                    // 帧中的记录数
+static uint32_t g_t_first = 0;             // 帧中第一条记录装入的时刻 (us)
+static uint16_t g_frame_seq = 0;           // 下一帧的序号
+static uint16_t g_frame_dropped = 0;       // 上一帧之后丢弃的记录数
+
+static uint8_t g_tx[2][FRAME_ENC_MAX];     // 编码后的帧
+static uint16_t g_tx_len[2];
+static volatile uint8_t g_tx_state[2];     // BUF_FREE / BUF_READY / BUF_BUSY
+static volatile uint8_t g_tx_cur = 0;      // 正在发送的缓冲区
+
+static TDC_StreamStatsTypeDef g_stats;
+
+/**
+ * @brief CRC-16/CCITT-FALSE 半字节查找表
+ */
+static const uint16_t g_crc_tab[16] = {
+    0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+    0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF,
+};
+
+static uint16_t crc16(const uint8_t *p, uint32_t len) {
+    uint16_t crc = 0xFFFF;
+
+    while (len--) {
+        crc = (uint16_t)(crc << 4) ^ g_crc_tab[(crc >> 12) ^ (*p >> 4)];
+        crc = (uint16_t)(crc << 4) ^ g_crc_tab[(crc >> 12) ^ (*p & 0x0F)];
+        p++;
+    }
+    return crc;
+}
+
+/**
+ * @brief COBS编码，输出中不含0x00
+ * @return 编码后的长度，不超过 len + len / 254 + 1
+ */
+static uint16_t cobs_encode(const uint8_t *src, uint16_t len, uint8_t *dst) {
+    uint16_t code_pos = 0, out = 1;
+    uint8_t code = 1;
+
+    for (uint16_t i = 0; i < len; i++) {
+        if (src[i] == 0) {
+            dst[code_pos] = code;
+            code_pos = out++;
+            code = 1;
+        } else {
+            dst[out++] = src[i];
+            if (++code == 0xFF) {  // 连续254个非零字节，开始新的一段
+                dst[code_pos] = code;
+                code_pos = out++;
+                code = 1;
+            }
+        }
+    }
+    dst[code_pos] = code;
+    return out;
+}
+
+static inline void put16(uint8_t *p, uint16_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static inline void put32(uint8_t *p, uint32_t v) {
+    put16(p, (uint16_t)v);
+    put16(p + 2, (uint16_t)(v >> 16));
+}
+
+/**
+ * @brief 按帧格式写入一条记录
+ */
+static void record_put(uint8_t *p, const TDC_RecordTypeDef *rec) {
+    uint8_t idx = (rec->ch == TDC_CH_STOP2) ? TDC_Hits_Stop1_Count(g_htdc, &rec->hits) : 0;
+
+    put32(p, rec->seq);
+    put32(p + 4, rec->timestamp);
+    p[8] = rec->ch;
+    p[9] = rec->hits.count;
+    put16(p + 10, rec->hits.status.raw);
+    put32(p + 12, (idx < rec->hits.count) ? rec->hits.raw[idx] : 0);
+    put32(p + 16, (uint32_t)rec->ps);
+    put32(p + 20, (uint32_t)((uint64_t)rec->ps >> 32));
+    p[24] = (rec->valid ? TDC_STREAM_FLAG_VALID : 0) | (rec->ref ? TDC_STREAM_FLAG_REF : 0);
+}
+
+/**
+ * @brief 没有缓冲区在发送时启动待发送的缓冲区
+ * @note  主循环和DMA中断都会调用，关中断保证只启动一次
+ */
+static void tx_kick(void) {
+    uint32_t primask = __get_PRIMASK();
+
+    __disable_irq();
+    if (g_tx_state[0] != BUF_BUSY && g_tx_state[1] != BUF_BUSY) {
+        for (uint8_t i = 0; i < 2; i++) {
+            if (g_tx_state[i] != BUF_READY)
+                continue;
+            g_tx_state[i] = BUF_BUSY;
+            g_tx_cur = i;
+            if (HAL_DMA_Start_IT(&hdma_tx, (uint32_t)g_tx[i], (uint32_t)&g_huart->Instance->TDR, g_tx_len[i]) != HAL_OK) {
+                g_tx_state[i] = BUF_FREE;
+                g_stats.errors++;
+            }
+            break;
+        }
+    }
+    __set_PRIMASK(primask);
+}
+
+static void tx_cplt(DMA_HandleTypeDef *hdma) {
+    g_tx_state[g_tx_cur] = BUF_FREE;
+    g_stats.frames++;
+    tx_kick();
+}
+
+static void tx_error(DMA_HandleTypeDef *hdma) {
+    g_tx_state[g_tx_cur] = BUF_FREE;
+    g_stats.errors++;
+    tx_kick();
+}
+
+/**
+ * @brief 封装当前帧并交给DMA
+ * @return 1 成功或帧为空；0 两个发送缓冲区都被占用
+ */
+static uint8_t frame_seal(void) {
+    uint16_t len;
+    uint8_t i;
+
+    if (g_n == 0)
+        return 1;
+
+    // 中断只会把缓冲区变为空闲，这里看到的空闲缓冲区不会被中断占用
+    for (i = 0; i < 2 && g_tx_state[i] != BUF_FREE; i++) {
+    }
+    if (i == 2)
+        return 0;
+
+    g_raw[0] = TDC_STREAM_TYPE_RECORDS;
+    g_raw[1] = g_n;
+    put16(g_raw + 2, g_frame_seq++);
+    put16(g_raw + 4, g_frame_dropped);
+    put16(g_raw + 6, (uint16_t)g_dwt_cycles_per_us);
+    len = TDC_STREAM_HEADER_SIZE + TDC_STREAM_RECORD_SIZE * g_n;
+    put16(g_raw + len, crc16(g_raw, len));
+    len += TDC_STREAM_CRC_SIZE;
+
+    g_tx_len[i] = cobs_encode(g_raw, len, g_tx[i]);
+    g_tx[i][g_tx_len[i]++] = 0x00;  // 帧结束符
+    g_tx_state[i] = BUF_READY;
+    g_n = 0;
+    g_frame_dropped = 0;
+
+    tx_kick();
+    return 1;
+}
+
+/**
+ * @brief 初始化遥测流
+ */
+HAL_StatusTypeDef TDC_Stream_Init(TDC_HandleTypeDef *htdc, UART_HandleTypeDef *huart) {
+    __HAL_RCC_DMA1_CLK_ENABLE();
+    hdma_tx.Instance = DMA1_Stream6;
+    hdma_tx.Init.Request = DMA_REQUEST_USART1_TX;
+    hdma_tx.Init.Direction = DMA_MEMORY_TO_PERIPH;
+    hdma_tx.Init.PeriphInc = DMA_PINC_DISABLE;
+    hdma_tx.Init.MemInc = DMA_MINC_ENABLE;
+    hdma_tx.Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
+    hdma_tx.Init.MemDataAlignment = DMA_MDATAALIGN_BYTE;
+    hdma_tx.Init.Mode = DMA_NORMAL;
+    hdma_tx.Init.Priority = DMA_PRIORITY_LOW;
+    hdma_tx.Init.FIFOMode = DMA_FIFOMODE_DISABLE;
+    if (HAL_DMA_Init(&hdma_tx) != HAL_OK)
+        return HAL_ERROR;
+
+    hdma_tx.XferCpltCallback = tx_cplt;
+    hdma_tx.XferErrorCallback = tx_error;
+    HAL_NVIC_SetPriority(DMA1_Stream6_IRQn, 5, 0);  // 低于TDC_INT，发送完成晚一点处理没有关系
+    HAL_NVIC_EnableIRQ(DMA1_Stream6_IRQn);
+
+    g_htdc = htdc;
+    g_huart = huart;
+    g_n = 0;
+    g_frame_seq = 0;
+    g_frame_dropped = 0;
+    g_tx_state[0] = BUF_FREE;
+    g_tx_state[1] = BUF_FREE;
+    g_stats.records = 0;
+    g_stats.frames = 0;
+    g_stats.dropped = 0;
+    g_stats.errors = 0;
+
+    // 串口只用DMA发送，不经过HAL_UART的状态机
+    SET_BIT(huart->Instance->CR3, USART_CR3_DMAT);
+    return HAL_OK;
+}
+
+/**
+ * @brief 加入一条记录
+ */
+uint8_t TDC_Stream_Push(const TDC_RecordTypeDef *rec) {
+    if (g_huart == NULL)
+        return 0;
+
+    if (g_n == TDC_STREAM_BATCH && !frame_seal()) {
+        g_stats.dropped++;
+        if (g_frame_dropped != 0xFFFF)
+            g_frame_dropped++;
+        return 0;
+    }
+
+    if (g_n == 0)
+        g_t_first = DWT_Micros();
+    record_put(g_raw + TDC_STREAM_HEADER_SIZE + TDC_STREAM_RECORD_SIZE * g_n, rec);
+    g_n++;
+    g_stats.records++;
+
+    if (g_n == TDC_STREAM_BATCH)
+        frame_seal();  // 缓冲区都被占用时留到下一次再试
+    return 1;
+}
+
+/**
+ * @brief 发送等待过久的未满帧
+ */
+void TDC_Stream_Poll(void) {
+    if (g_n != 0 && DWT_Micros() - g_t_first >= TDC_STREAM_FLUSH_US)
+        frame_seal();
+}
+
+/**
+ * @brief 获取遥测流计数
+ */
+void TDC_Stream_Get_Stats(TDC_StreamStatsTypeDef *stats) {
+    uint32_t primask = __get_PRIMASK();
+
+    __disable_irq();
+    *stats = g_stats;
+    __set_PRIMASK(primask);
+}
+
+/**
+ * @brief 发送DMA中断处理
+ */
+void TDC_Stream_IRQHandler(void) {
+    HAL_DMA_IRQHandler(&hdma_tx);
+}